@@ -0,0 +1,365 @@
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <istream>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "analyze.h"
+#include "dataset.h"
+#include "eval.h"
+#include "gnubg_id.h"
+#include "pos_rank.h"
+#include "rollout.h"
+
+namespace {
+
+/// <summary>
+/// Queue between the stages of the pipeline: pop waits for an item, or
+/// returns false once the queue is closed and empty
+/// </summary>
+template<class T>
+class work_queue
+{
+public:
+    void push(T&& x)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            q.push_back(std::move(x));
+        }
+        cv.notify_one();
+    }
+    bool pop(T& x)
+    {
+        std::unique_lock<std::mutex> lock(m);
+        cv.wait(lock, [this] { return !q.empty() || closed; });
+        if (q.empty())
+            return false;
+        x = std::move(q.front());
+        q.pop_front();
+        return true;
+    }
+    bool empty()
+    {
+        std::lock_guard<std::mutex> lock(m);
+        return q.empty();
+    }
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            closed = true;
+        }
+        cv.notify_all();
+    }
+
+private:
+    std::mutex              m;
+    std::condition_variable cv;
+    std::deque<T>           q;
+    bool                    closed = false;
+};
+
+/// <summary>
+/// Count of the lines read and not yet written: the reader waits while there are 'limit'
+/// </summary>
+class flight
+{
+public:
+    explicit flight(size_t limit) : limit(std::max<size_t>(limit, 1)) {}
+
+    void acquire()
+    {
+        std::unique_lock<std::mutex> lock(m);
+        cv.wait(lock, [this] { return n < limit; });
+        ++n;
+    }
+    void release()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            --n;
+        }
+        cv.notify_one();
+    }
+
+private:
+    std::mutex              m;
+    std::condition_variable cv;
+    size_t                  n = 0;
+    size_t                  limit;
+};
+
+struct job
+{
+    uint64                  seq;
+    uint64                  line;
+    std::string             text;
+    const dataset_record*   record;     // the position, instead of the text
+};
+
+struct result
+{
+    uint64          seq;
+    bool            error;
+    std::string     text;
+    bool            has_record;         // record: the position and its results
+    dataset_record  record;
+};
+
+// s as a JSON string
+std::string json_string(const std::string& s)
+{
+    std::string r = "\"";
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+            r += '\\';
+        if (uint8(c) < 0x20)
+        {
+            char u[8];
+            std::snprintf(u, sizeof u, "\\u%04x", unsigned(uint8(c)));
+            r += u;
+        }
+        else
+            r += c;
+    }
+    return r + "\"";
+}
+
+// s as a CSV field
+std::string csv_field(const std::string& s)
+{
+    if (s.find_first_of(",\"\r\n") == std::string::npos)
+        return s;
+    std::string r = "\"";
+    for (char c : s)
+    {
+        if (c == '"')
+            r += '"';
+        r += c;
+    }
+    return r + "\"";
+}
+
+const char* csv_header = "line,id,pwin,pwin_se,equity,equity_se,games,error";
+
+// The result line of a job
+result analyze_one(const job& j, const analysis_options& opt)
+{
+    result r{ j.seq, false, j.text, false, dataset_record{} };
+    std::ostringstream s;
+    s.precision(6);
+    Board b;
+    Color to_move;
+    if (j.record)
+    {
+        b = j.record->board();
+        to_move = j.record->side();
+        r.text = position_id(b, to_move);
+    }
+    if (!j.record && !parse_position(j.text, b, to_move))
+    {
+        r.error = true;
+        if (opt.csv)
+            s << j.line << ',' << csv_field(r.text) << ",,,,,,not a position";
+        else
+            s << "{\"line\":" << j.line << ",\"id\":" << json_string(r.text) << ",\"error\":\"not a position\"}";
+    }
+    else if (opt.games == 0)
+    {
+        bool terminal;
+        float p = b.eval(terminal, to_move);
+        if (opt.csv)
+            s << j.line << ',' << csv_field(r.text) << ',' << p << ",,,,0,";
+        else
+            s << "{\"line\":" << j.line << ",\"id\":" << json_string(r.text) << ",\"pwin\":" << p << '}';
+        if ((r.has_record = opt.results && make_record(b, to_move, r.record)))
+        {
+            r.record.source = dataset_record::evaluation;
+            r.record.pwin = p;
+            r.record.equity = 2 * p - 1;
+        }
+    }
+    else
+    {
+        // One thread per rollout: the positions are the parallel work
+        rollout_options ro;
+        ro.threads = 1;
+        ro.seed = j.line;
+        rollout_result x = rollout(b, to_move, opt.games, ro);
+        if (opt.csv)
+            s << j.line << ',' << csv_field(r.text) << ',' << x.pwin.mean << ',' << x.pwin.std_error << ','
+                << x.equity.mean << ',' << x.equity.std_error << ',' << x.games << ',';
+        else
+            s << "{\"line\":" << j.line << ",\"id\":" << json_string(r.text)
+                << ",\"pwin\":" << x.pwin.mean << ",\"pwin_se\":" << x.pwin.std_error
+                << ",\"equity\":" << x.equity.mean << ",\"equity_se\":" << x.equity.std_error
+                << ",\"games\":" << x.games << '}';
+        if ((r.has_record = opt.results && make_record(b, to_move, r.record)))
+        {
+            r.record.source = dataset_record::rollout;
+            r.record.games = uint32(x.games);
+            r.record.pwin = float(x.pwin.mean);
+            r.record.pwin_se = float(x.pwin.std_error);
+            r.record.equity = float(x.equity.mean);
+            r.record.equity_se = float(x.equity.std_error);
+        }
+    }
+    r.text = s.str();
+    return r;
+}
+
+}
+
+bool parse_position(const std::string& s, Board& b, Color& to_move)
+{
+    std::istringstream in(s);
+    std::string id, side, extra;
+    if (!(in >> id))
+        return false;
+    // A match ID after the position ID tells the side on roll
+    match_id m;
+    size_t colon = id.find(':');
+    bool has_match = colon != std::string::npos;
+    if (has_match && !m.decode(id.substr(colon + 1)))
+        return false;
+    if (has_match)
+        id.resize(colon);
+    to_move = has_match ? m.on_roll : Black;
+    if (in >> side)
+    {
+        if (has_match)
+            return false;
+        if (side == "W" || side == "w")
+            to_move = White;
+        else if (side != "B" && side != "b")
+            return false;
+    }
+    if (in >> extra)
+        return false;
+
+    if (decode_position_id(id, b, to_move))
+        return true;
+    if (has_match || id.size() > 16 || id.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos)
+        return false;
+    pos_rank::Key key = std::stoull(id, nullptr, 16);
+    if (key >= prank.size())
+        return false;
+    prank.unrank(key, b);
+    return true;
+}
+
+std::string position_id(const Board& b, Color to_move)
+{
+    if (!pos_rank::rankable(b))
+        return std::string();
+    char s[24];
+    std::snprintf(s, sizeof s, "%016llx %c", (unsigned long long)prank.rank(b), to_move == White ? 'W' : 'B');
+    return s;
+}
+
+namespace {
+
+// The pipeline: next(j) sets the line and the text or record of the next job, false at the end of the input
+template<class Next>
+uint64 run(Next next, std::ostream& out, const analysis_options& opt)
+{
+    work_queue<job> jobs;
+    work_queue<result> results;
+    flight lines(opt.in_flight);
+
+    int n_threads = opt.threads > 0 ? opt.threads : std::max(1, int(std::thread::hardware_concurrency()));
+    std::vector<std::thread> workers;
+    for (int t = 0; t < n_threads; ++t)
+        workers.emplace_back([&] {
+            // Not the fallbacks of a warm up in progress: the results would depend on the timing
+            evaluation.wait();
+            job j;
+            while (jobs.pop(j))
+                results.push(analyze_one(j, opt));
+        });
+
+    // Write the results as they come, or hold them until their turn
+    uint64 errors = 0;
+    std::thread writer([&] {
+        if (opt.csv)
+            out << csv_header << '\n';
+        std::map<uint64, result> held;
+        uint64 next = 0;
+        result r;
+        while (results.pop(r))
+        {
+            auto write = [&](const result& x) {
+                out << x.text << '\n';
+                if (x.has_record)
+                    opt.results->append(x.record);
+                errors += x.error;
+                lines.release();
+            };
+            if (!opt.ordered)
+                write(r);
+            else
+            {
+                held.emplace(r.seq, std::move(r));
+                for (auto it = held.begin(); it != held.end() && it->first == next; it = held.erase(it), ++next)
+                    write(it->second);
+            }
+            if (results.empty())
+                out.flush();
+        }
+        out.flush();
+    });
+
+    uint64 seq = 0;
+    for (job j{ 0, 0, std::string(), nullptr }; next(j); j = job{ 0, 0, std::string(), nullptr })
+    {
+        lines.acquire();
+        j.seq = seq++;
+        jobs.push(std::move(j));
+    }
+    jobs.close();
+    for (auto& t : workers)
+        t.join();
+    results.close();
+    writer.join();
+    return errors;
+}
+
+}
+
+uint64 analyze(std::istream& in, std::ostream& out, const analysis_options& opt)
+{
+    std::string text;
+    uint64 line = 0;
+    return run([&](job& j) {
+        while (std::getline(in, text))
+        {
+            ++line;
+            size_t first = text.find_first_not_of(" \t\r");
+            if (first == std::string::npos)
+                continue;
+            size_t last = text.find_last_not_of(" \t\r");
+            j.line = line;
+            j.text = text.substr(first, last - first + 1);
+            return true;
+        }
+        return false;
+    }, out, opt);
+}
+
+uint64 analyze(const dataset_reader& in, std::ostream& out, const analysis_options& opt)
+{
+    uint64 i = 0;
+    return run([&](job& j) {
+        if (i == in.size())
+            return false;
+        j.record = &in[i++];
+        j.line = i;
+        return true;
+    }, out, opt);
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <iosfwd>
+#include <string>
+#include "board.h"
+#include "inttyp.h"
+
+struct dataset_reader;
+struct dataset_writer;
+
+struct analysis_options
+{
+	int		threads = 0;		// workers, 0: one per hardware thread
+	uint64	games = 0;			// rollout games per position, 0: static evaluation
+	bool	ordered = false;	// write the results in the order of the input
+	bool	csv = false;		// CSV instead of JSON lines
+	size_t	in_flight = 4096;	// most lines read and not yet written
+	dataset_writer*	results = nullptr;	// also append the positions and their results there
+};
+
+/// <summary>
+/// Text ID of a position: the pos_rank key in hexadecimal or a 14 character
+/// GNU Backgammon position ID, then the side to roll, W or B (B when omitted).
+/// The position ID may be followed by ':' and a match ID, which tells the side to roll.
+/// 14 characters are read as a position ID first, then as a key.
+/// </summary>
+/// <returns>false if s is not the ID of a position</returns>
+bool		parse_position(const std::string& s, Board& b, Color& to_move);
+// Empty for the positions pos_rank can not key (more than max_bar checkers on a bar)
+std::string	position_id(const Board& b, Color to_move);
+
+/// <summary>
+/// Analyze a stream of positions: one position ID per line from in, one
+/// result per line to out, as the workers finish them (or in order).
+/// Lines in flight are bounded, so memory stays flat on any input size.
+/// Blank lines are skipped; a line which is not a position gets an error result.
+/// </summary>
+/// <returns># of lines in error</returns>
+uint64		analyze(std::istream& in, std::ostream& out, const analysis_options& opt);
+/// <summary>
+/// Analyze the positions of a dataset, the same way: the line of a result is the record # from 1
+/// </summary>
+uint64		analyze(const dataset_reader& in, std::ostream& out, const analysis_options& opt);
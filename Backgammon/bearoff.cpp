@@ -0,0 +1,305 @@
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <vector>
+#include "bearoff.h"
+#include "enr.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool mapped_file::open(const std::string& path)
+{
+    close();
+#ifdef _WIN32
+    HANDLE f = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (f == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER sz;
+    HANDLE m = GetFileSizeEx(f, &sz) && sz.QuadPart > 0 ? CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    const void* v = m ? MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!v)
+    {
+        if (m) CloseHandle(m);
+        CloseHandle(f);
+        return false;
+    }
+    file = f;
+    mapping = m;
+    size = size_t(sz.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    void* v = fstat(fd, &st) == 0 && st.st_size > 0 ? mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    if (v == MAP_FAILED)
+    {
+        ::close(fd);
+        return false;
+    }
+    file = reinterpret_cast<void*>(intptr_t(fd));
+    size = size_t(st.st_size);
+#endif
+    data = static_cast<const char*>(v);
+    return true;
+}
+
+void mapped_file::close()
+{
+    if (!data)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+    CloseHandle(mapping);
+    CloseHandle(file);
+#else
+    munmap(const_cast<char*>(data), size);
+    ::close(int(intptr_t(file)));
+#endif
+    data = nullptr;
+    size = 0;
+    file = mapping = nullptr;
+}
+
+bearoff_db::Hash bearoff_db::hash(const table& b)
+{
+    int k = bearoff_db::k - 1;
+    Hash _hash = 0;
+    for (int i = 0; i < n_points; ++i)
+    {
+        int n = n_points + 1 - i;
+        k -= b[i];
+        _hash += mc(n, k);
+    }
+    return _hash;
+}
+
+bearoff_db::table& bearoff_db::inverse_hash(Hash h, table& b)
+{
+    int K = 0;
+    Hash H = h; // invariant: H >= 0
+    for (int i = 0; i <= n_points; ++i)
+    {
+        int k = K;
+        Hash delta;
+        while ((delta = H - mc(n_points + 1 - i, bearoff_db::k - (k + 1))) < 0)
+            ++k;
+        H = delta;      // delta >= 0
+        b[i] = k - K;   // k >= K
+        K = k;
+    }
+    Assert(h == hash(b));
+    return b;
+}
+
+bool bearoff_db::covers(const Board& b, Color c)
+{
+    int n = 0;
+    for (int i = 0; i <= n_points; ++i)
+        n += (c == White) ? b.count<White>(25 - i) : b.count<Black>(25 - i);
+    return n == k;
+}
+
+bearoff_db::Hash bearoff_db::hash(const Board& b, Color c)
+{
+    Assert(covers(b, c));
+    table t;
+    for (int i = 0; i <= n_points; ++i)
+        t[i] = (c == White) ? b.count<White>(25 - i) : b.count<Black>(25 - i);
+    return hash(t);
+}
+
+namespace {
+
+using Hash = bearoff_db::Hash;
+
+/// <summary>
+/// Store the hash of the least ENR board
+/// </summary>
+struct minENRhash {
+    minENRhash(const std::vector<float>& enr) : enr(enr), min_enr(std::numeric_limits<float>::infinity()), hash(0) {}
+
+    const std::vector<float>& enr;
+    float min_enr;
+    Hash hash;
+
+    // MoveContainer interface
+    void push_board(const Board& b)
+    {
+        Hash h = bearoff_db::hash(b, White);
+        if (min_enr > enr[h])
+        {
+            min_enr = enr[h];
+            hash = h;
+        }
+    }
+    bool stop() const { return min_enr <= 0; }
+};
+
+// White checkers from table t, Black finished
+Board race_board(const bearoff_db::table& t)
+{
+    Board b;
+    std::memset(&b.board[0], 0, sizeof b.board);
+    for (int i = 0; i <= bearoff_db::n_points; ++i)
+        b.board[25 - i] = t[i];
+    b._finishedB = 15;
+    b._barB = 0;
+    b.ComputePipCount();
+    return b;
+}
+
+}
+
+void bearoff_db::build()
+{
+    using Dist = finite_support_vector;
+
+    // Densities in hash order, packed as they are written
+    std::vector<uint32> idx;
+    std::vector<uint16> words;
+    std::vector<float> enr;     // E[X] of each position, to pick the min ENR moves
+    idx.reserve(n_bearoff_positions + 1);
+    enr.reserve(n_bearoff_positions);
+
+    // The densities are also kept as floats, so that the rounding
+    // of the packed copy does not compound from position to position.
+    std::vector<uint32> den_start;
+    std::vector<uint8> den_lower;
+    std::vector<float> den;
+    den_start.reserve(n_bearoff_positions);
+    den_lower.reserve(n_bearoff_positions);
+    auto len = [&](Hash h) { return (h + 1 < Hash(den_start.size()) ? den_start[h + 1] : den.size()) - den_start[h]; };
+
+    auto push = [&](const Dist& d)
+    {
+        // Pack, trimming entries which round to 0 at either end
+        std::vector<uint16> q(d.support.size());
+        for (size_t i = 0; i < q.size(); ++i)
+            q[i] = uint16(d.support[i] * 65535 + 0.5f);
+        size_t lo = 0, hi = q.size();
+        while (hi > lo + 1 && q[hi - 1] == 0) --hi;
+        while (lo + 1 < hi && q[lo] == 0) ++lo;
+        Assert(hi - lo < 256 && d.lower() + lo < 256);
+
+        idx.push_back(uint32(words.size()));
+        words.push_back(uint16((d.lower() + lo) | (hi - lo) << 8));
+        words.insert(words.end(), q.begin() + lo, q.begin() + hi);
+
+        double e = 0.0;
+        den_start.push_back(uint32(den.size()));
+        den_lower.push_back(uint8(d.lower()));
+        for (size_t i = 0; i < d.support.size(); ++i)
+        {
+            den.push_back(d.support[i]);
+            e += (d.lower() + i) * d.support[i];
+        }
+        enr.push_back(float(e));
+    };
+
+    push(Dist(1.0));    // all checkers finished: P(X=0) = 1.0
+
+    table t;
+    for (Hash h = 1; h < n_bearoff_positions; ++h)
+    {
+        Board b = race_board(inverse_hash(h, t));
+
+        std::array<Hash, 21> H;     // The hash of the best move for each roll
+        size_t lo = 255, hi = 0;    // Low and High bounds for density being computed
+        for (auto& r : Roll::rolls21)
+        {
+            minENRhash best(enr);
+            genMoves<White>(best, b, r);
+            Assert(best.hash < h);
+            H[r.ordinal] = best.hash;
+            lo = std::min(lo, size_t(den_lower[best.hash]));
+            hi = std::max(hi, den_lower[best.hash] + len(best.hash));
+        }
+
+        Dist d(hi, lo);
+        for (auto& r : Roll::rolls21)
+        {
+            Hash c = H[r.ordinal];     // best move for roll r
+            size_t n = len(c);
+            int j = den_lower[c] - lo;
+            for (size_t i = 0; i < n; ++i)
+                d.support[j++] += r.p * den[den_start[c] + i];
+        }
+        d.shift();      // Shift data by one to count move from this position
+        push(d);
+    }
+    idx.push_back(uint32(words.size()));
+
+    file.close();
+    built_index = std::move(idx);
+    built_data = std::move(words);
+    index = built_index.data();
+    data = built_data.data();
+}
+
+bool bearoff_db::save(const std::string& path) const
+{
+    if (empty())
+        return false;
+    std::ofstream out(path, std::ios::binary);
+    header hd;
+    std::memcpy(hd.magic, "BGBEAR10", 8);
+    hd.version = version;
+    hd.n_points = n_points;
+    hd.n_positions = n_bearoff_positions;
+    hd.n_data = index[n_bearoff_positions];
+    out.write(reinterpret_cast<const char*>(&hd), sizeof hd);
+    out.write(reinterpret_cast<const char*>(index), (size_t(n_bearoff_positions) + 1) * sizeof index[0]);
+    out.write(reinterpret_cast<const char*>(data), size_t(hd.n_data) * sizeof data[0]);
+    return bool(out);
+}
+
+bool bearoff_db::open(const std::string& path)
+{
+    if (!file.open(path) || file.size < sizeof(header))
+        return false;
+    const header& hd = *reinterpret_cast<const header*>(file.data);
+    size_t expect = sizeof(header) + (size_t(n_bearoff_positions) + 1) * sizeof(uint32) + size_t(hd.n_data) * sizeof(uint16);
+    if (std::memcmp(hd.magic, "BGBEAR10", 8) != 0 || hd.version != version || hd.n_points != n_points
+        || hd.n_positions != n_bearoff_positions || file.size != expect)
+    {
+        file.close();
+        return false;
+    }
+    index = reinterpret_cast<const uint32*>(file.data + sizeof(header));
+    data = reinterpret_cast<const uint16*>(index + n_bearoff_positions + 1);
+    return true;
+}
+
+float bearoff_db::Pwin(Hash hw, Hash hb) const
+{
+    Assert(data && 0 <= hw && hw < n_bearoff_positions && 0 <= hb && hb < n_bearoff_positions);
+    const uint16* w = data + index[hw];     // player to move
+    const uint16* b = data + index[hb];     // opponent
+    int lw = w[0] & 0xff, nw = w[0] >> 8;
+    int lb = b[0] & 0xff, nb = b[0] >> 8;
+
+    // The player to move wins if X(to move) <= X(opponent)
+    // sum over n of P(Xw = n) * P(Xb >= n)
+    uint64 pwin = 0, tail = 0;  // tail: 65535 * P(Xb >= n)
+    for (int n = lw + nw - 1, j = lb + nb - 1; n >= lw; --n)
+    {
+        for (; j >= n && j >= lb; --j)
+            tail += b[1 + j - lb];
+        pwin += uint64(w[1 + n - lw]) * tail;
+    }
+    return float(double(pwin) / (65535.0 * 65535.0));
+}
+
+float bearoff_db::Pwin(const Board& b, Color to_move) const
+{
+    return Pwin(hash(b, to_move), hash(b, opponent(to_move)));
+}
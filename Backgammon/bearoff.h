@@ -0,0 +1,126 @@
+#pragma once
+#include <array>
+#include <string>
+#include <vector>
+#include "eg_hash.h"
+#include "board.h"
+
+constexpr int n_bearoff_positions = 3268760;	// multichoose(11,15)
+
+/// <summary>
+/// A read only view of a whole file mapped into memory
+/// </summary>
+struct mapped_file
+{
+	mapped_file() : data(nullptr), size(0), file(nullptr), mapping(nullptr) {}
+	~mapped_file() { close(); }
+	mapped_file(const mapped_file&) = delete;
+	mapped_file& operator=(const mapped_file&) = delete;
+
+	bool open(const std::string& path);
+	void close();
+
+	const char*	data;
+	size_t		size;
+
+private:
+	void*		file;		// file handle / descriptor
+	void*		mapping;	// file mapping handle (Windows)
+};
+
+// eval_context holds the shared instance
+/// <summary>
+/// One-sided bearoff database: for every position of 15 checkers on the
+/// last 10 points or finished, the density P(X=n) of the number of turns X
+/// needed to bare off when always playing the min ENR move.
+///
+/// Positions are hashed like eg_hash's inner tables, with 11 slots: slot 0
+/// finished, slot i the C relative pip 25-i. Every move leads to a smaller
+/// hash, so the densities are computed in hash order (as PNR does).
+///
+/// On disk and mapped in memory:
+///		header
+///		uint32	index[n_bearoff_positions + 1]	start of each density in data
+///		uint16	data[]							per position: lower | count << 8,
+///												then count densities * 65535
+/// </summary>
+struct bearoff_db
+{
+	using Hash = eg_hash::Hash;
+
+	static const int n_points = 10;
+	static const int k = 15;
+	using table = std::array<int, n_points + 1>;
+
+	static constexpr std::array<std::array<int64, k + 2>, n_points + 1> multi_choose = multichoose_table<n_points + 1, k>();
+
+	struct header
+	{
+		char	magic[8];		// "BGBEAR10"
+		uint32	version;
+		uint32	n_points;
+		uint32	n_positions;
+		uint32	n_data;			// # of uint16 in data
+	};
+	static constexpr uint32 version = 1;
+	static constexpr const char* default_path = "bearoff10.db";
+
+	static int64 mc(int64 n, int64 k)
+	{
+		Assert(1 <= n && n <= n_points + 1 && -1 <= k && k <= bearoff_db::k);
+		return multi_choose[n - 1][k + 1];
+	}
+
+	/// <summary>
+	/// Perfect hash of the table b: x < y ==> hash(y) < hash(x)
+	/// where x < y is lexicographic order
+	/// </summary>
+	static Hash		hash(const table& b);
+	/// <summary>
+	/// Invert the hash function: writes the table with Hash h into b
+	/// </summary>
+	static table&	inverse_hash(Hash h, table& b);
+
+	// Are all checkers of side C on its last 10 points or finished
+	static bool		covers(const Board& b, Color c);
+	// Hash of the checkers of side C (covers(b, C))
+	static Hash		hash(const Board& b, Color c);
+
+	/// <summary>
+	/// Compute the densities of all positions, held in memory (about 90 s)
+	/// </summary>
+	void			build();
+	/// <summary>
+	/// Write the database (built or mapped) to 'path'
+	/// </summary>
+	/// <returns>false if the file can not be written</returns>
+	bool			save(const std::string& path) const;
+
+	/// <summary>
+	/// Map the database file 'path'
+	/// </summary>
+	/// <returns>false if missing or not a database</returns>
+	bool			open(const std::string& path);
+
+	/// <summary>
+	/// The Win probability of the player to move
+	/// when both players use the min ENR strategy
+	/// </summary>
+	/// <param name="to_move">hash of player to move</param>
+	/// <param name="opp">hash of opponent</param>
+	/// <returns>P(player to move wins)</returns>
+	float			Pwin(Hash to_move, Hash opp) const;
+	// P(to_move wins) of a race with both sides covered
+	float			Pwin(const Board& b, Color to_move) const;
+
+	bool			empty() const { return data == nullptr; }
+
+private:
+	mapped_file			file;
+	std::vector<uint32>	built_index;	// the database when built rather than mapped
+	std::vector<uint16>	built_data;
+	const uint32*		index = nullptr;
+	const uint16*		data = nullptr;
+};
+
+static_assert(multichoose(11, 15) == n_bearoff_positions, "bearoff positions");
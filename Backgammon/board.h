@@ -3,12 +3,46 @@
 #include <array>
 #include <map>
 #include <algorithm>
+#include <type_traits>
 #include "roll.h"
 #include "range.h"
 #include "scm.h"
 
 class GameTree;
 
+enum Color { White, Black };
+constexpr Color opponent(Color c) { return Color(c ^ 1); }
+
+/// <summary>
+/// A MoveContainer may end move generation early by defining 'bool stop() const',
+/// polled after its push_board calls. The board is restored as usual.
+/// Containers without stop() never stop, and the polls compile away.
+/// </summary>
+template<class MoveContainer>
+auto stopped(const MoveContainer& tree, int) -> decltype(tree.stop()) { return tree.stop(); }
+template<class MoveContainer>
+constexpr bool stopped(const MoveContainer&, long) { return false; }
+template<class MoveContainer>
+bool stopped(const MoveContainer& tree) { return stopped(tree, 0); }
+
+/// <summary>
+/// A MoveContainer may follow the checkers played by the generator by defining
+/// 'void moved(Pip from, Pip to)' and 'void unmoved(Pip from, Pip to)', called as
+/// each checker is moved and moved back (pips relative to the side to move, 25 is off).
+/// This lets it keep values of the current board up to date by deltas.
+/// </summary>
+template<class MoveContainer>
+auto moved(MoveContainer& tree, Pip from, Pip to, int) -> decltype(tree.moved(from, to)) { tree.moved(from, to); }
+template<class MoveContainer>
+void moved(MoveContainer&, Pip, Pip, long) {}
+template<class MoveContainer>
+auto unmoved(MoveContainer& tree, Pip from, Pip to, int) -> decltype(tree.unmoved(from, to)) { tree.unmoved(from, to); }
+template<class MoveContainer>
+void unmoved(MoveContainer&, Pip, Pip, long) {}
+
+template<class MoveContainer>
+using IsContainer = std::enable_if_t<std::is_class<MoveContainer>::value>;
+
 struct Info
 {
 	Bitboard occ_w;		// pips occupied by 1 or more white checkers
@@ -19,6 +53,31 @@ struct Info
 };
 
 
+/// <summary>
+/// Probabilities of the results of the game for the side to move
+/// (win includes the gammons and backgammons)
+/// </summary>
+struct Outcome
+{
+	float win;
+	float win_gammon;
+	float win_backgammon;
+	float lose_gammon;
+	float lose_backgammon;
+};
+
+/// <summary>
+/// Position classes, nested: Exact => Bareoff => Bearoff10 => Race.
+/// A contact position has none of the bits.
+/// </summary>
+enum PositionClass : uint32
+{
+	Contact		= 0,
+	Race		= 1 << 0,	// no contact
+	Bearoff10	= 1 << 1,	// both sides on their last 10 points or finished (bearoff_db)
+	Bareoff		= 1 << 2,	// both sides in their inner board or finished (bareoff_race)
+	Exact		= 1 << 3,	// and at most 7 checkers each on the board (p_exact)
+};
 
 struct Board {
 	// From White perspective
@@ -45,7 +104,7 @@ struct Board {
 	int16 pipCntB;
 
 	// Flip the board and initialize Info of the flipped board.
-	Board(const Board& b, Info& info) : _finishedB(b.finished()), _barB(b.Wbar()), pipCntW(pipCntB), pipCntB(pipCntW)
+	Board(const Board& b, Info& info) : _finishedB(b.finished()), _barB(b.Wbar()), pipCntW(b.pipCntB), pipCntB(b.pipCntW)
 	{
 		board[0] = b._barB;
 		int			inner = board[25] = b._finishedB;	// checkers in inner board or finished
@@ -123,11 +182,27 @@ struct Board {
 	bool  bareoffW()	const;	// All W checkers in inner board or finished
 	bool  bareoffB()	const;	// All B checkers in inner board or finished
 	bool  bareoff_race()const;	// Both White and Black bareing-off
-	float eval(bool& terminal)			const;	// %win: black to move
-	float endgame_eval(bool& terminal)	const;
-
-	// ** TO DO ** Score backgammon
-	float	Won() { return (finished() == 15) ? 1 + (_finishedB == 0) : 0; }
+	float eval(bool& terminal, Color to_move = Black)			const;	// %win: side to move
+	// p[i] = boards[i].eval(to_move), the boards grouped by PositionClass
+	static void eval(const Board* boards, size_t n, float* p, Color to_move = Black);
+	float endgame_eval(bool& terminal, Color to_move = Black)	const;
+	Outcome race_outcome(Color to_move = Black)					const;	// bareoff_race() only
+	float effective_pips(Color c)								const;	// pips to bare off, wastage included
+	float race_eval(Color to_move = Black)						const;	// %win: SCM of the effective pips
+	uint32 position_class()										const;	// PositionClass bits
+
+	// Score of White: 1, 2 for a gammon, 3 for a backgammon (Black on the bar or in White's home board)
+	float	Won()
+	{
+		if (finished() != 15)
+			return 0;
+		if (_finishedB != 0)
+			return 1;
+		bool backgammon = _barB > 0;
+		for (int i = 19; i <= 24; ++i)
+			backgammon |= board[i] < 0;
+		return backgammon ? 3 : 2;
+	}
 
 	// Debug utility
 	bool ComputePipCount()
@@ -149,74 +224,189 @@ struct Board {
 		return correct;
 	}
 
-	void _hit(uint to)
+	/// <summary>
+	/// Checkers on pip p from the perspective of side C.
+	/// Pips are numbered in the direction C moves: bar 0, pips 1..24, finished 25.
+	/// Counts are positive for checkers of C, negative for the opponent.
+	/// </summary>
+	template<Color C>
+	int count(Pip p) const
+	{
+		if (C == White)
+			return board[p];
+		return (p == w_bar) ? _barB : (p == 25) ? _finishedB : -board[25 - p];
+	}
+	// count<C>(p) of pips p = 1..24 on the board
+	template<Color C>
+	int pt(Pip p) const { return (C == White) ? board[p] : -board[25 - p]; }
+	// Add n checkers of side C to pip p (C relative)
+	template<Color C>
+	void add(Pip p, int n)
+	{
+		if (C == White)
+			board[p] += n;
+		else if (p == w_bar)
+			_barB += n;
+		else if (p == 25)
+			_finishedB += n;
+		else
+			board[25 - p] -= n;
+	}
+	template<Color C> int		bar()		const	{ return (C == White) ? board[0] : _barB; }
+	template<Color C> int		finished()	const	{ return (C == White) ? board[25] : _finishedB; }
+	template<Color C> int16&	pipCnt()			{ return (C == White) ? pipCntW : pipCntB; }
+	// Bar and pip count of the opponent of side C
+	template<Color C> int8&		oppBar()			{ return (C == White) ? _barB : board[0]; }
+	template<Color C> int16&	oppPipCnt()			{ return (C == White) ? pipCntB : pipCntW; }
+
+	// Points won by C once it has finished: 1, 2 for a gammon, 3 for a backgammon
+	// (the opponent on the bar or in the inner board of C)
+	template<Color C>
+	int points() const
+	{
+		if (finished<opponent(C)>() > 0)
+			return 1;
+		bool backgammon = bar<opponent(C)>() > 0;
+		for (Pip p = 19; p <= 24; ++p)
+			backgammon |= pt<C>(p) < 0;
+		return backgammon ? 3 : 2;
+	}
+	int points(Color c) const { return (c == White) ? points<White>() : points<Black>(); }
+
+	/// <summary>
+	/// Compute the move generation Info of side C in place
+	/// (bitboards use the C relative pip numbering)
+	/// </summary>
+	template<Color C>
+	void get_info(Info& info) const
+	{
+		int			inner = finished<C>();	// checkers in inner board or finished
+		Bitboard	occ_w = NO_SQUARES, pt_b = NO_SQUARES;
+
+		for (Pip i = 1; i < 25; ++i)
+		{
+			int c = pt<C>(i);
+			if (c > 0)
+			{
+				occ_w |= i;
+				if (i > 18)
+					inner += c;
+			}
+			else if (c < -1)
+				pt_b |= i;
+		}
+
+		info.occ_w = occ_w;
+		info.outside = 15 - inner;
+		info.avail = andn((info.outside < 4 && bar<C>() == 0) ? BAREOFF : BOARD, pt_b);
+	}
+
+	/// <summary>
+	/// The board from the perspective of the other side.
+	/// Flipping is only required by callers which need a Black to move
+	/// orientation; move generation works in place for either side.
+	/// </summary>
+	Board flipped() const
+	{
+		Info info;
+		return Board(*this, info);
+	}
+
+	template<Color C = White>
+	void _hit(Pip to)
 	{
-		Assert(board[to] == -1);
-		board[to] = 1;
-		++_barB;
-		pipCntB += (25 - to);
+		Assert(pt<C>(to) == -1);
+		add<C>(to, 2);
+		++oppBar<C>();
+		oppPipCnt<C>() += (25 - to);
 	}
-	int8 decr(Pip from) { return --board[from]; }
+	template<Color C = White>
+	void decr(Pip from) { add<C>(from, -1); }
+	template<Color C = White>
 	void incr(Pip to, bool& hit)
 	{
-		uint to_cnt = board[to];
-		if ((hit = (to_cnt < 0)))
-			_hit(to);
+		if ((hit = (count<C>(to) < 0)))
+			_hit<C>(to);
 		else
-			board[to] = to_cnt + 1;
+			add<C>(to, 1);
 	}
+	template<Color C = White>
 	bool incr(Pip to)
 	{
 		bool hit;
-		incr(to, hit);
+		incr<C>(to, hit);
 		return hit;
 	}
+	template<Color C = White>
 	void _undoHit(Pip to)
 	{
-		board[to] = -1;
-		--_barB;
-		pipCntB -= (25 - to);
+		add<C>(to, -2);
+		--oppBar<C>();
+		oppPipCnt<C>() -= (25 - to);
 	}
+	template<Color C = White>
 	void undoMove(Pip from, Pip to, bool hit)
 	{
-		pipCntW += (to - from);
-		++board[from];
-		if (hit) _undoHit(to); else --board[to];
+		pipCnt<C>() += (to - from);
+		add<C>(from, 1);
+		if (hit) _undoHit<C>(to); else add<C>(to, -1);
 	}
+	template<Color C = White>
 	void move(Pip from, Pip to, bool& hit)
 	{
 		Assert((to <= 25) && (to > from));
-		pipCntW -= (to - from);
-		decr(from);
-		incr(to, hit);
+		pipCnt<C>() -= (to - from);
+		decr<C>(from);
+		incr<C>(to, hit);
 	}
 	// return hit rather than last
-	bool move(uint from, uint to)
+	template<Color C = White>
+	bool move(Pip from, Pip to)
 	{
-		pipCntW -= (to - from);
-		decr(from);
-		return incr(to);
+		pipCnt<C>() -= (to - from);
+		decr<C>(from);
+		return incr<C>(to);
 	}
-	int8 bareOff(uint from, uint to)
+	template<Color C = White>
+	void bareOff(Pip from, Pip to)
 	{
 		Assert(from > 18);
-		pipCntW -= (25 - from);
-		++board[25]; return --board[from];
+		pipCnt<C>() -= (25 - from);
+		add<C>(25, 1);
+		add<C>(from, -1);
 	}
-	void undoBareOff(uint from, uint to)
+	template<Color C = White>
+	void undoBareOff(Pip from, Pip to)
 	{
-		++board[from]; --board[25];
-		pipCntW += (25 - from);
+		add<C>(from, 1);
+		add<C>(25, -1);
+		pipCnt<C>() += (25 - from);
 	}
 
-	// occupied by White
-	bool occupied(Pip p) { return board[p] > 0; }
-	// available as destination of White move
-	bool avail(Pip p) { return board[p] >= -1; }
+	// The primitives of the move generators: they also notify the container (see moved())
+	template<Color C, class MoveContainer, class = IsContainer<MoveContainer>>
+	bool move(MoveContainer& tree, Pip from, Pip to) { moved(tree, from, to, 0); return move<C>(from, to); }
+	template<Color C, class MoveContainer, class = IsContainer<MoveContainer>>
+	void move(MoveContainer& tree, Pip from, Pip to, bool& hit) { moved(tree, from, to, 0); move<C>(from, to, hit); }
+	template<Color C, class MoveContainer, class = IsContainer<MoveContainer>>
+	void undoMove(MoveContainer& tree, Pip from, Pip to, bool hit) { unmoved(tree, from, to, 0); undoMove<C>(from, to, hit); }
+	template<Color C, class MoveContainer>
+	void bareOff(MoveContainer& tree, Pip from, Pip to) { moved(tree, from, 25, 0); bareOff<C>(from, to); }
+	template<Color C, class MoveContainer>
+	void undoBareOff(MoveContainer& tree, Pip from, Pip to) { unmoved(tree, from, 25, 0); undoBareOff<C>(from, to); }
+
+	// occupied by White (side C)
+	template<Color C = White>
+	bool occupied(Pip p) { return pt<C>(p) > 0; }
+	// available as destination of White (side C) move
+	template<Color C = White>
+	bool avail(Pip p) { return pt<C>(p) >= -1; }
 	// No checkers on the pip
-	bool empty(Pip p) { return board[p] == 0; }
-	// A Black blot on the pip
-	bool blot(Pip p) { return board[p] == -1; }
+	template<Color C = White>
+	bool empty(Pip p) { return pt<C>(p) == 0; }
+	// A Black (opponent of C) blot on the pip
+	template<Color C = White>
+	bool blot(Pip p) { return count<C>(p) == -1; }
 
 	bool operator<  (const Board& b) const
 	{
@@ -230,40 +420,50 @@ struct Board {
 		if (pipCntB > b.pipCntB) return false;
 		return board > b.board;
 	}
+	bool operator== (const Board& b) const
+	{
+		return board == b.board && _barB == b._barB && _finishedB == b._finishedB;
+	}
 
 	// Are there any checkers on the inner board behind pip f (so it can bare off excess rolls)
+	template<Color C = White>
 	bool backmost(Pip f, Pip& to) {
 		for (int i = 19; i < f; ++i)
-			if (board[i] > 0)
+			if (pt<C>(i) > 0)
 				return false;
 		return to = 25, true;
 	}
-	bool bareoffOK(Pip f, Pip& to, int outside) { Assert(to >= 25); return outside == 0 && (to == 25 || backmost(f, to)); }
+	template<Color C = White>
+	bool bareoffOK(Pip f, Pip& to, int outside) { Assert(to >= 25); return outside == 0 && (to == 25 || backmost<C>(f, to)); }
 	bool crossover(Pip f, Pip t) { return f < 19 && t >= 19; }
 
 	template<class MoveContainer>
 	void push_board(MoveContainer& tree) { tree.push_board(*this); }
 
 
-	template<class MoveContainer>
+	template<Color C, class MoveContainer>
 	void enqueMove(MoveContainer& tree, Pip from, Pip to)
 	{
-		bool hit = move(from, to);
+		bool hit = move<C>(tree, from, to);
 		push_board(tree);
-		undoMove(from, to, hit);
+		undoMove<C>(tree, from, to, hit);
 	}
 
-	template<class MoveContainer>
+	template<Color C, class MoveContainer>
 	void genOne(MoveContainer& tree, Bitboard w, Die d)
 	{
 		for (auto from : w)
-			enqueMove(tree, from, from + d);
+		{
+			enqueMove<C>(tree, from, from + d);
+			if (stopped(tree))
+				return;
+		}
 	}
 
-	template<class MoveContainer>
+	template<Color C, class MoveContainer>
 	void genMovesFromBar(MoveContainer& tree, Info& info, Die hi, Die lo)
 	{
-		Assert(Wbar());
+		Assert(bar<C>());
 		int to_hi = hi;
 		int to_lo = lo;
 		Bitboard occ_w = info.occ_w;
@@ -281,18 +481,18 @@ struct Board {
 
 		if (hi != lo)
 		{
-			if (Wbar() > 1)	// more than one checker on the bar
+			if (bar<C>() > 1)	// more than one checker on the bar
 			{
 				// Only possible move is bar\hi bar\lo
 				if (a_hi)
-					move(w_bar, to_hi, hit_hi);
+					move<C>(tree, w_bar, to_hi, hit_hi);
 				if (a_lo)
-					move(w_bar, to_lo, hit_lo);
+					move<C>(tree, w_bar, to_lo, hit_lo);
 				push_board(tree);
 				if (a_hi)
-					undoMove(w_bar, to_hi, hit_hi);
+					undoMove<C>(tree, w_bar, to_hi, hit_hi);
 				if (a_lo)
-					undoMove(w_bar, to_lo, hit_lo);
+					undoMove<C>(tree, w_bar, to_lo, hit_lo);
 				return;
 			}
 			else // one checker on the bar
@@ -303,11 +503,11 @@ struct Board {
 				{
 					if (Bitboard w_lo = (occ_w | hi) & (avail >> lo))	// pips from which w can move the lo roll
 					{
-						move(w_bar, to_hi, hit_hi);
-						genOne(tree, w_lo, lo);
-						undoMove(w_bar, to_hi, hit_hi);
+						move<C>(tree, w_bar, to_hi, hit_hi);
+						genOne<C>(tree, w_lo, lo);
+						undoMove<C>(tree, w_bar, to_hi, hit_hi);
 						both_moves_taken = true;
-						if (member(avail, hi + lo) && board[lo] >= 0 && !hit_hi)
+						if (member(avail, hi + lo) && pt<C>(lo) >= 0 && !hit_hi)
 						{
 							// If we generated a bar/hi/hi+lo move 
 							// and neither board[hi] nor board[lo] are hits
@@ -318,31 +518,31 @@ struct Board {
 					}
 				}
 
-				if (a_lo)
+				if (a_lo && !stopped(tree))
 				{
 					if (Bitboard w_hi = (occ_w | lo) & (avail >> hi))	// pips from which w can move the hi roll)
 					{
-						move(w_bar, to_lo, hit_lo);
-						genOne(tree, w_hi, hi);
-						undoMove(w_bar, to_lo, hit_lo);
+						move<C>(tree, w_bar, to_lo, hit_lo);
+						genOne<C>(tree, w_hi, hi);
+						undoMove<C>(tree, w_bar, to_lo, hit_lo);
 						both_moves_taken = true;
 					}
 				}
 
 				if (!both_moves_taken)
 				{
-					// unable to take both moves
+					// unable to take both moves: play the hi roll if possible
 					if (a_hi)
 					{
-						move(w_bar, to_hi, hit_hi);
+						move<C>(tree, w_bar, to_hi, hit_hi);
 						push_board(tree);
-						undoMove(w_bar, to_hi, hit_hi);
+						undoMove<C>(tree, w_bar, to_hi, hit_hi);
 					}
-					if (a_lo)
+					else
 					{
-						move(w_bar, to_lo, hit_lo);
+						move<C>(tree, w_bar, to_lo, hit_lo);
 						push_board(tree);
-						undoMove(w_bar, to_lo, hit_lo);
+						undoMove<C>(tree, w_bar, to_lo, hit_lo);
 					}
 				}
 			}
@@ -350,26 +550,31 @@ struct Board {
 		else // hi==lo -- rolled doubles
 		{
 			Assert(a_hi);
-			int checkers_on_bar = Wbar();
-			int moves_from_bar = std::max(4, checkers_on_bar);
+			int checkers_on_bar = bar<C>();
+			int moves_from_bar = std::min(4, checkers_on_bar);
 
 			// bare on up to 4 checkers
-			move(w_bar, to_hi, hit_hi);		// The first bareOn may be a hit
+			move<C>(tree, w_bar, to_hi, hit_hi);		// The first bareOn may be a hit
 			for (int i = 1; i < moves_from_bar; ++i)
-				move(w_bar, to_hi);
+				move<C>(tree, w_bar, to_hi);
 
-			Bitboard w_hi = (occ_w | to_hi) & (avail << hi);	// pips from which w can move the hi roll
-			int moves_remaining = 4 - moves_from_bar;
-			genMovesDoubles(tree, info, hi, moves_remaining);
+			// Play the remaining moves once every checker has entered
+			int moves_remaining = bar<C>() ? 0 : 4 - moves_from_bar;
+			genMovesDoubles<C>(tree, occ_w | to_hi, avail, info.outside, hi, moves_remaining);
 
 			// Undo the bare on's
 			for (int i = 1; i < moves_from_bar; ++i)
-				undoMove(w_bar, to_hi, false);
-			undoMove(w_bar, to_hi, hit_hi);
+				undoMove<C>(tree, w_bar, to_hi, false);
+			undoMove<C>(tree, w_bar, to_hi, hit_hi);
 		}
 	}
 
-	template<class MoveContainer>
+	/// <summary>
+	/// Generate the moves playing n checkers by d pips from the pips in occ.
+	/// avail: pips from which a move of d pips is available
+	/// Returns false if n moves can not be played.
+	/// </summary>
+	template<Color C, Die D = 0, class MoveContainer>
 	bool genN(MoveContainer& tree, Bitboard occ, Bitboard avail, Die d, int outside, int n)
 	{
 		if (n == 0)
@@ -377,9 +582,10 @@ struct Board {
 			push_board(tree);
 			return true;
 		}
+		occ = occ & avail & BOARD;
 		if (!occ)
 		{
-			if (finished() == 15)
+			if (finished<C>() == 15)
 			{
 				push_board(tree);
 				return true;
@@ -389,8 +595,10 @@ struct Board {
 		}
 
 		int from = *occ;
+		if (D)
+			d = D;	// compile time constant: shifts and bare off tests fold
 		int to = from + d;
-		int cnt = std::min(n, int(board[from]));
+		int cnt = std::min(n, pt<C>(from));
 
 		// Bare off?
 		if (to > 24)
@@ -400,14 +608,14 @@ struct Board {
 				if (to > 25)
 				{
 					for (int i = 19; i < from; ++i)
-						if (board[i] > 0)
+						if (pt<C>(i) > 0)
 							return false;
 				}
 				for (int i = 0; i < cnt; ++i)
-					bareOff(from,to);
-				bool ret = genN(tree, ++occ, avail, d, 0, n - cnt);
+					bareOff<C>(tree, from, to);
+				bool ret = genN<C, D>(tree, ++occ, avail, d, 0, n - cnt);
 				for (int i = 0; i < cnt; ++i)
-					undoBareOff(from,to);
+					undoBareOff<C>(tree, from, to);
 				return ret;
 			}
 			Assert(outside > 0);
@@ -420,95 +628,102 @@ struct Board {
 
 
 		// make cnt from/to moves (recording hit)
-		bool hit = move(from, to);
+		bool hit = move<C>(tree, from, to);
 		for (int i = 1; i < cnt; ++i)
-			move(from, to);
+			move<C>(tree, from, to);
 
 		// update the count of checkers outside of inner table
 		int moved_in = (to > 18) && (from <= 18) ? cnt : 0;
 
 		// try generating moves if we play 
 		// cnt checkers from this pip
-		bool ret = genN(tree, occN, avail, d, outside - moved_in, n - cnt);
-		bool more = ret;
+		bool ret = genN<C, D>(tree, occN, avail, d, outside - moved_in, n - cnt);
+		bool more = ret && !stopped(tree);
 
 		while (--cnt > 0)
 		{
 			// Try generating moves if we play
 			// cnt-1 .. 1 checkers from this pip.
-			undoMove(from, to, false);
+			undoMove<C>(tree, from, to, false);
 			if (more)
-				more = genN(tree, occN, avail, d, outside - (moved_in ? cnt : 0), n - cnt);
+				more = genN<C, D>(tree, occN, avail, d, outside - (moved_in ? cnt : 0), n - cnt) && !stopped(tree);
 		}
-		undoMove(from, to, hit);
+		undoMove<C>(tree, from, to, hit);
 		if (more)
-			genN(tree, occ, avail, d, outside, n);
+			genN<C, D>(tree, occ, avail, d, outside, n);
 		return ret;
 	}
 
-	template<class MoveContainer>
-	void genMovesDoubles(MoveContainer& tree, Info& info, Die d, int n = 4)
+	template<Color C, Die D = 0, class MoveContainer>
+	void genMovesDoubles(MoveContainer& tree, Bitboard occ, Bitboard avail, int outside, Die d, int n = 4)
 	{
 		// Try to generate n moves from this position, 
 		// if that fails (genN returns false) try (n-1)..0 until success
 		// genN returns true when n == 0
-		while (!genN(tree, info.occ_w, info.avail - d, d, info.outside, n))
+		if (D)
+			d = D;
+		while (!genN<C, D>(tree, occ, avail >> d, d, outside, n))
 		{
 			Assert(n > 0);
 			--n;
 		}
 	}
 
-	template<class MoveContainer>
+	template<Color C, Die D, class MoveContainer>
+	void genMovesDoubles(MoveContainer& tree, Info& info)
+	{
+		genMovesDoubles<C, D>(tree, info.occ_w, info.avail, info.outside, D);
+	}
+
+	template<Color C, class MoveContainer>
 	bool genHL(MoveContainer& tree, Bitboard occ, Bitboard a_hi, Bitboard a_lo, Die hi, Die lo, int outside)
 	{
-		Assert(finished() < 15);
+		Assert(finished<C>() < 15);
 
 		bool ret = false;
-		while (occ)
+		while (occ && !stopped(tree))
 		{
 			Pip f = *occ; ++occ;	// iterate over occupied Pips
 
 			Pip to_hi = f + hi, to_lo = f + lo;
-			bool move_hi = member(a_hi, f) && ((to_hi < 25) || bareoffOK(f, to_hi, outside));
-			bool move_lo = member(a_lo, f) && ((to_lo < 25) || bareoffOK(f, to_lo, outside));
+			bool move_hi = member(a_hi, f) && ((to_hi < 25) || bareoffOK<C>(f, to_hi, outside));
+			bool move_lo = member(a_lo, f) && ((to_lo < 25) || bareoffOK<C>(f, to_lo, outside));
 
 			if (move_hi)
 			{
-				bool hit_hi = move(f, to_hi);
-				if (move_lo && board[f] > 0)
+				bool hit_hi = move<C>(tree, f, to_hi);
+				if (move_lo && pt<C>(f) > 0)
 				{
-					enqueMove(tree, f, to_lo);
+					enqueMove<C>(tree, f, to_lo);
 					ret = true;
 				}
 
 				// complete the move taking the lo roll from a pip further down the board
-				ret |= genN(tree, occ + to_hi, a_lo, lo, outside - crossover(f, to_hi), 1);
-				undoMove(f, to_hi, hit_hi);
+				ret |= genN<C>(tree, occ + to_hi, a_lo, lo, outside - crossover(f, to_hi), 1);
+				undoMove<C>(tree, f, to_hi, hit_hi);
 			}
-			if (move_lo && to_hi != to_lo)	// to_hi == to_lo if both rolls bareoff from f
+			if (move_lo && to_hi != to_lo && !stopped(tree))	// to_hi == to_lo if both rolls bareoff from f
 			{
-				bool hit_lo = move(f, to_lo);
+				bool hit_lo = move<C>(tree, f, to_lo);
 				// Avoid duplicate moves: f/f+lo+hi == f/f+hi/f+lo+hi == f/f+lo/f+lo+hi
-				Bitboard avail_hi = (move_hi && !(hit_lo || blot(to_hi))) ? a_hi - to_lo : a_hi;
+				Bitboard avail_hi = (move_hi && !(hit_lo || blot<C>(to_hi))) ? a_hi - to_lo : a_hi;
 
 				// complete the move taking the hi roll from a pip further down the board
-				ret |= genN(tree, occ + to_lo, avail_hi, hi, outside - crossover(f, to_lo), 1);
-				undoMove(f, to_lo, hit_lo);
+				ret |= genN<C>(tree, occ + to_lo, avail_hi, hi, outside - crossover(f, to_lo), 1);
+				undoMove<C>(tree, f, to_lo, hit_lo);
 			}
 		}
 		return ret;
 	}
 
-	template<class MoveContainer>
+	template<Color C, class MoveContainer>
 	void genMovesHiLo(MoveContainer& tree, Info& info, Die hi, Die lo)
 	{
-		if (!genHL(tree, info.occ_w, info.avail >> hi, info.avail >> lo, hi, lo, info.outside))
+		if (!genHL<C>(tree, info.occ_w, info.avail >> hi, info.avail >> lo, hi, lo, info.outside))
 		{
-			// Cannot play both hi and lo rolls. Try playing just one of the die.
-			bool play_hi = genN(tree, info.occ_w, info.avail >> hi, hi, info.outside, 1);
-			bool play_lo = genN(tree, info.occ_w, info.avail >> lo, lo, info.outside, 1);
-			if (!(play_hi || play_lo))
+			// Cannot play both hi and lo rolls. Play the hi roll if possible, otherwise the lo roll.
+			if (!genN<C>(tree, info.occ_w, info.avail >> hi, hi, info.outside, 1)
+				&& !genN<C>(tree, info.occ_w, info.avail >> lo, lo, info.outside, 1))
 			{
 				// can not play any move
 				push_board(tree);	// null move
@@ -516,15 +731,50 @@ struct Board {
 		}
 	}
 
-	template<class MoveContainer>
-	void genMoves(MoveContainer& tree, Info& info, Die hi, Die lo)
+	/// <summary>
+	/// Generate the moves of side C for the roll Hi-Lo, known at compile time.
+	/// Doubles recurse with a constant die; the other rolls pass Hi and Lo
+	/// as constant arguments, which the compiler may propagate when inlining.
+	/// </summary>
+	template<Color C, Die Hi, Die Lo, class MoveContainer>
+	void genRoll(MoveContainer& tree, Info& info)
 	{
-		if (Wbar())
-			genMovesFromBar(tree, info, hi, lo);
-		else if (hi == lo)
-			genMovesDoubles(tree, info, hi);
+		if (bar<C>())
+			genMovesFromBar<C>(tree, info, Hi, Lo);
+		else if (Hi == Lo)
+			genMovesDoubles<C, Hi>(tree, info);
 		else
-			genMovesHiLo(tree, info, hi, lo);
+			genMovesHiLo<C>(tree, info, Hi, Lo);
+	}
+
+	/// <summary>
+	/// Generate the moves of side C, dispatching on Roll::ordinal
+	/// to the genRoll instance of the roll
+	/// </summary>
+	template<Color C = White, class MoveContainer>
+	void genMoves(MoveContainer& tree, Info& info, const Roll& r)
+	{
+		using Gen = void (Board::*)(MoveContainer&, Info&);
+		static constexpr Gen gen[21] = {
+			&Board::genRoll<C, 2, 1, MoveContainer>, &Board::genRoll<C, 3, 1, MoveContainer>,
+			&Board::genRoll<C, 1, 1, MoveContainer>, &Board::genRoll<C, 4, 1, MoveContainer>,
+			&Board::genRoll<C, 3, 2, MoveContainer>, &Board::genRoll<C, 5, 1, MoveContainer>,
+			&Board::genRoll<C, 4, 2, MoveContainer>, &Board::genRoll<C, 6, 1, MoveContainer>,
+			&Board::genRoll<C, 5, 2, MoveContainer>, &Board::genRoll<C, 4, 3, MoveContainer>,
+			&Board::genRoll<C, 6, 2, MoveContainer>, &Board::genRoll<C, 5, 3, MoveContainer>,
+			&Board::genRoll<C, 2, 2, MoveContainer>, &Board::genRoll<C, 6, 3, MoveContainer>,
+			&Board::genRoll<C, 5, 4, MoveContainer>, &Board::genRoll<C, 6, 4, MoveContainer>,
+			&Board::genRoll<C, 6, 5, MoveContainer>, &Board::genRoll<C, 3, 3, MoveContainer>,
+			&Board::genRoll<C, 4, 4, MoveContainer>, &Board::genRoll<C, 5, 5, MoveContainer>,
+			&Board::genRoll<C, 6, 6, MoveContainer>,
+		};
+		Assert(0 <= r.ordinal && r.ordinal < 21);
+		(this->*gen[r.ordinal])(tree, info);
+	}
+	template<Color C = White, class MoveContainer>
+	void genMoves(MoveContainer& tree, Info& info, Die hi, Die lo)
+	{
+		genMoves<C>(tree, info, Roll(hi, lo));
 	}
 
 };
@@ -551,7 +801,40 @@ struct BoardInfo : Board
 template<class MoveContainer>
 void genMoves(MoveContainer& tree, BoardInfo& b, const Roll& r)
 {
-	b.genMoves(tree, b.get_Info(), r.hi, r.lo);
+	b.genMoves(tree, b.get_Info(), r);
+}
+
+
+/// <summary>
+/// Generate the moves of side C in place, without flipping the board.
+/// The boards pushed keep the orientation of b.
+/// </summary>
+template<Color C, class MoveContainer>
+void genMoves(MoveContainer& tree, Board& b, const Roll& r)
+{
+	Info info;
+	b.get_info<C>(info);
+	b.genMoves<C>(tree, info, r);
 }
 
+template<class MoveContainer>
+void genMoves(MoveContainer& tree, Board& b, const Roll& r, Color to_move)
+{
+	if (to_move == White)
+		genMoves<White>(tree, b, r);
+	else
+		genMoves<Black>(tree, b, r);
+}
+
+/// <summary>
+/// MoveContainer keeping the first successor and stopping generation there
+/// </summary>
+struct FirstMove
+{
+	Board	board;
+	bool	found = false;
 
+	// MoveContainer interface
+	void push_board(const Board& b) { board = b; found = true; }
+	bool stop() const { return found; }
+};
@@ -0,0 +1,186 @@
+#include <limits>
+#include "cube.h"
+#include "eval.h"
+
+/// <summary>
+/// Accumulate, for each cube state, the minimum cubeful equity of the
+/// opponent (hb to move) over the boards pushed.
+/// The inner_hash base follows the moves of the generator from the hash of the root board.
+/// </summary>
+struct minEcube : inner_hash {
+    minEcube(Hash hb, Hash root, const cube_exact& e) : inner_hash(root), e(e), hb(hb)
+    {
+        min_e.fill(std::numeric_limits<float>::infinity());
+    }
+
+    const cube_exact& e;
+    Hash hb;
+    std::array<float, n_cube_states> min_e;
+
+    // MoveContainer interface
+    void push_board(const Board& b)
+    {
+        Assert(hash == eg.hash_w(b));
+        for (int s = 0; s < n_cube_states; ++s)
+            min_e[s] = std::min(min_e[s], e.Equity(hb, hash, flip(CubeState(s))));
+    }
+    // The opponent can not do worse than losing the cube
+    bool stop() const { return min_e[Centered] <= -1 && min_e[Owned] <= -1 && min_e[Unavailable] <= -1; }
+};
+
+// compute the no double equities of (hw,hb) inner boards
+// assuming they have been computed for all positions (w,b)
+// with (w+b) < (hw+hb).
+void cube_exact::init_cube_exact(Hash hw, Hash hb, BoardInfo& b)
+{
+    std::array<double, n_cube_states> nd = {};
+    for (auto& r : Roll::rolls21)
+    {
+        minEcube min_e(hb, eg.hash_w(b), *this);
+        genMoves(min_e, b, r);
+        for (int s = 0; s < n_cube_states; ++s)
+            nd[s] -= r.p * min_e.min_e[s];
+    }
+    for (int s = 0; s < n_cube_states; ++s)
+        no_double[s][hw][hb] = float(nd[s]);
+}
+
+// compute the equities of the first (n_exact,n_exact) inner boards
+void cube_exact::init_cube_exact()
+{
+    // Init terminal positions: a finished side has won one cube
+    for (auto& t : no_double)
+    {
+        t[0][0] = 1.0;
+        for (int i = 1; i < n_exact; ++i)
+        {
+            t[0][i] = 1.0;
+            t[i][0] = -1.0;
+        }
+    }
+
+    // compute arrays diagonal by diagonal, as p_exact
+
+    // Fill sub diagonals up to main diagonal
+    for (int i = 1; i < n_exact; ++i)
+    {
+        inner_table_iterator it;
+        for (int hb = i; hb > 0; --hb)
+        {
+            BoardInfo B(*++it);
+            init_cube_exact(it._hash, hb, B);
+        }
+    }
+    // Fill super diagonals
+    for (int i = 2; i < n_exact; ++i)
+    {
+        inner_table_iterator it(i);
+        for (int hb = n_exact - 1; it._hash < n_exact; --hb, ++it)
+        {
+            BoardInfo B(*it);
+            init_cube_exact(it._hash, hb, B);
+        }
+    }
+}
+
+float janowski_equity(const Outcome& o, CubeState s, float x)
+{
+    float p = o.win;
+    // Average value of a win and of a loss
+    float W = p > 0 ? 1 + (o.win_gammon + o.win_backgammon) / p : 1;
+    float L = p < 1 ? 1 + (o.lose_gammon + o.lose_backgammon) / (1 - p) : 1;
+
+    float dead = p * (W + L) - L;
+
+    // Live cube: linear between the take point and the cash point
+    float tp = (L - 0.5f) / (W + L + 0.5f);
+    float cp = (L + 1.0f) / (W + L + 0.5f);
+    float live;
+    switch (s)
+    {
+    case Centered:
+        live = p <= tp ? -1 : p >= cp ? 1 : -1 + 2 * (p - tp) / (cp - tp);
+        break;
+    case Owned:
+        live = p >= cp ? 1 : p * (W + L + 0.5f) - L;
+        break;
+    default:
+        live = p <= tp ? -1 : p * (W + L + 0.5f) - L - 0.5f;
+        break;
+    }
+    return x * live + (1 - x) * dead;
+}
+
+float race_cube_efficiency(int pips)
+{
+    // Cubes lose value as the race gets shorter
+    return std::min(0.7f, std::max(0.6f, 0.55f + 0.00125f * pips));
+}
+
+namespace {
+
+// (to move, opponent) inner board hashes; exact if both are in the p_exact tables
+eg_hash::BwHash race_hash(const Board& b, Color to_move, bool& exact)
+{
+    const auto min_finished = 15 - p_exact::n;
+    auto h = eg.hash_bw(b);     // (Black, White)
+    if (to_move == White)
+        std::swap(h.first, h.second);
+    exact = b.finishedW() >= min_finished && b.finishedB() >= min_finished;
+    return h;
+}
+
+float cube_efficiency(const Board& b, Color to_move)
+{
+    return race_cube_efficiency(to_move == White ? b.pipW() : b.pipB());
+}
+
+// Janowski equities of the side to move: no double and double/take
+void janowski_actions(const Board& b, Color to_move, CubeState s, float& no_double, float& double_take)
+{
+    Outcome o = b.race_outcome(to_move);
+    float x = cube_efficiency(b, to_move);
+    no_double = janowski_equity(o, s, x);
+    double_take = 2 * janowski_equity(o, Unavailable, x);
+}
+
+bool cube_ready(const Board& b)
+{
+    return b.bareoff_race() && evaluation.ready();
+}
+
+}
+
+float race_cube_equity(const Board& b, Color to_move, CubeState s)
+{
+    Assert(b.bareoff_race());
+    bool exact;
+    auto h = race_hash(b, to_move, exact);
+    if (exact)
+        return evaluation.cube().Equity(h.first, h.second, s);
+    float nd, dt;
+    janowski_actions(b, to_move, s, nd, dt);
+    return s == Unavailable ? nd : std::max(nd, std::min(dt, 1.0f));
+}
+
+bool offer_double(const Board& b, Color to_move, CubeState s)
+{
+    if (s == Unavailable || !cube_ready(b))
+        return false;
+    bool exact;
+    auto h = race_hash(b, to_move, exact);
+    if (exact)
+        return evaluation.cube().Double(h.first, h.second, s);
+
+    float nd, dt;
+    janowski_actions(b, to_move, s, nd, dt);
+    return std::min(dt, 1.0f) > nd;
+}
+
+bool accept_double(const Board& b, Color doubler, CubeState after)
+{
+    if (!cube_ready(b))
+        return true;
+    // Take unless passing loses less than the doubled game, the cube as it is after the take
+    return 2 * race_cube_equity(b, doubler, after) <= 1.0f;
+}
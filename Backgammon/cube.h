@@ -0,0 +1,96 @@
+#pragma once
+#include <algorithm>
+#include "pwinx.h"
+#include "board.h"
+
+/// <summary>
+/// State of the doubling cube seen from the side to move
+/// </summary>
+enum CubeState : int
+{
+	Centered,		// either side may double
+	Owned,			// the side to move owns the cube
+	Unavailable		// the opponent owns the cube
+};
+constexpr int n_cube_states = 3;
+
+// The same cube seen from the opponent
+constexpr CubeState flip(CubeState s) { return s == Centered ? Centered : CubeState(Owned + Unavailable - s); }
+
+// singleton class (an instance of eval_context)
+/// <summary>
+/// Exact cubeful money equities of the p_exact positions: both sides baring
+/// off with at most 7 checkers, so no gammons. Equities are per unit of the
+/// current cube value, for the side to move, before it decides to double.
+///
+/// Computed by the same recursion as p_exact, diagonal by diagonal, with the
+/// moves chosen for each cube state. Only the no double equities are stored:
+/// the cube action is decided from them when looked up.
+/// </summary>
+struct cube_exact
+{
+	using Hash = eg_hash::Hash;
+	static const Hash N = p_exact::N;
+	using Table = std::array<std::array<float, N>, N>;
+
+	/// <summary>
+	/// Equity when the side to move rolls without doubling, by cube state
+	/// </summary>
+	std::array<Table, n_cube_states> no_double;
+
+	cube_exact() { init_cube_exact(); }
+	// class initializers
+	void	init_cube_exact();
+	void	init_cube_exact(Hash hw, Hash hb, BoardInfo& b);
+
+	// Equity of the side to move after double/take
+	float	double_take(Hash toMove, Hash opp) const { return 2 * no_double[Unavailable][toMove][opp]; }
+
+	/// <summary>
+	/// Should the side to move double
+	/// </summary>
+	bool	Double(Hash toMove, Hash opp, CubeState s) const
+	{
+		return s != Unavailable && std::min(double_take(toMove, opp), 1.0f) > no_double[s][toMove][opp];
+	}
+	/// <summary>
+	/// Should the opponent take a double of the side to move
+	/// </summary>
+	bool	Take(Hash toMove, Hash opp) const { return double_take(toMove, opp) <= 1.0f; }
+
+	/// <summary>
+	/// The cubeful equity of the side to move, for optimal cube actions and moves
+	/// </summary>
+	/// <param name="toMove">inner board hash of player to move</param>
+	/// <param name="opp">inner board hash of opponent</param>
+	/// <param name="s">cube state seen from the player to move</param>
+	float	Equity(Hash toMove, Hash opp, CubeState s) const
+	{
+		float nd = no_double[s][toMove][opp];
+		return s == Unavailable ? nd : std::max(nd, std::min(double_take(toMove, opp), 1.0f));
+	}
+};
+
+/// <summary>
+/// Janowski's cubeful money equity: the cubeless outcome interpolated between
+/// a dead cube (x = 0) and a fully live cube (x = 1) of cube efficiency x.
+/// </summary>
+/// <returns>equity per unit of the current cube of the side to move</returns>
+float	janowski_equity(const Outcome& o, CubeState s, float x);
+
+/// <summary>
+/// Cube efficiency of a race with 'pips' to bear off for the side to move
+/// </summary>
+float	race_cube_efficiency(int pips);
+
+/// <summary>
+/// Cubeful equity of a bareoff race (bareoff_race()): exact in the p_exact
+/// region, Janowski from the PNR outcome elsewhere.
+/// </summary>
+float	race_cube_equity(const Board& b, Color to_move, CubeState s);
+
+// Cube actions: decided from the race tables in bareoff races once they are
+// ready, otherwise the side to move never doubles and every double is taken.
+// s is the cube seen from the side to move; after, the cube once the double is taken, seen from the doubler.
+bool	offer_double(const Board& b, Color to_move, CubeState s);
+bool	accept_double(const Board& b, Color doubler, CubeState after = Unavailable);
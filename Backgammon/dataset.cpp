@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <cstring>
+#include "dataset.h"
+#include "pos_rank.h"
+
+namespace {
+
+using header = dataset_file::header;
+using index_entry = dataset_file::index_entry;
+
+const char magic[8] = { 'B', 'G', 'D', 'A', 'T', 'A', '0', '1' };
+
+header make_header(uint64 count, uint64 index_count)
+{
+    header hd;
+    std::memcpy(hd.magic, magic, sizeof magic);
+    hd.version = dataset_file::version;
+    hd.record_size = sizeof(dataset_record);
+    hd.count = count;
+    hd.index_count = index_count;
+    return hd;
+}
+
+bool valid(const header& hd)
+{
+    return std::memcmp(hd.magic, magic, sizeof magic) == 0 && hd.version == dataset_file::version
+        && hd.record_size == sizeof(dataset_record) && (hd.index_count == 0 || hd.index_count == hd.count);
+}
+
+}
+
+Board dataset_record::board() const
+{
+    Board b;
+    prank.unrank(key, b);
+    return b;
+}
+
+bool make_record(const Board& b, Color to_move, dataset_record& r)
+{
+    if (!pos_rank::rankable(b))
+        return false;
+    r = dataset_record{};
+    r.key = prank.rank(b);
+    r.to_move = uint8(to_move);
+    return true;
+}
+
+bool dataset_writer::open(const std::string& path, bool append, bool index_records)
+{
+    close();
+    count = 0;
+    indexed = index_records;
+    header hd;
+    if (append)
+    {
+        out.open(path, std::ios::in | std::ios::out | std::ios::binary);
+        if (out.is_open() && !out.read(reinterpret_cast<char*>(&hd), sizeof hd) && out.gcount() == 0)
+            out.close();        // an empty file: a new dataset
+        if (out.is_open())
+        {
+            if (!out || !valid(hd))
+            {
+                out.close();    // not a dataset: leave it alone
+                return false;
+            }
+            count = hd.count;
+            // The keys of the records there, for the new index
+            for (uint64 i = 0; indexed && i < count; i += chunk)
+            {
+                buffer.resize(size_t(std::min<uint64>(chunk, count - i)));
+                if (!out.read(reinterpret_cast<char*>(buffer.data()), buffer.size() * sizeof(dataset_record)))
+                {
+                    out.close();
+                    return false;
+                }
+                for (size_t k = 0; k < buffer.size(); ++k)
+                    index.push_back(index_entry{ buffer[k].key, uint64(buffer[k].to_move) << 63 | (i + k) });
+            }
+            buffer.clear();
+            // The new records overwrite the old index: readers see none until close
+            hd = make_header(count, 0);
+            out.seekp(0);
+            out.write(reinterpret_cast<const char*>(&hd), sizeof hd);
+            out.seekp(sizeof hd + count * sizeof(dataset_record));
+            return bool(out);
+        }
+        out.clear();
+    }
+    out.open(path, std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
+    hd = make_header(0, 0);
+    out.write(reinterpret_cast<const char*>(&hd), sizeof hd);
+    out.flush();
+    return bool(out);
+}
+
+bool dataset_writer::append(const dataset_record& r)
+{
+    if (!out.is_open())
+        return false;
+    if (indexed)
+        index.push_back(index_entry{ r.key, uint64(r.to_move) << 63 | count });
+    buffer.push_back(r);
+    ++count;
+    return buffer.size() < chunk || flush();
+}
+
+bool dataset_writer::flush()
+{
+    out.write(reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(dataset_record));
+    buffer.clear();
+    return bool(out);
+}
+
+bool dataset_writer::close()
+{
+    if (!out.is_open())
+        return true;
+    bool ok = flush();
+    if (indexed)
+    {
+        std::sort(index.begin(), index.end());
+        out.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(index_entry));
+    }
+    header hd = make_header(count, indexed ? count : 0);
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&hd), sizeof hd);
+    ok &= bool(out);
+    out.close();
+    std::vector<dataset_record>().swap(buffer);
+    std::vector<index_entry>().swap(index);
+    return ok;
+}
+
+bool dataset_reader::open(const std::string& path)
+{
+    close();
+    if (!file.open(path))
+        return false;
+    const header& hd = *reinterpret_cast<const header*>(file.data);
+    if (file.size < sizeof hd || !valid(hd) || hd.count > (file.size - sizeof hd) / sizeof(dataset_record)
+        || hd.index_count * sizeof(index_entry) > file.size - sizeof hd - hd.count * sizeof(dataset_record))
+    {
+        file.close();
+        return false;
+    }
+    n = hd.count;
+    n_index = hd.index_count;
+    records = reinterpret_cast<const dataset_record*>(file.data + sizeof hd);
+    index = reinterpret_cast<const index_entry*>(records + n);
+    return true;
+}
+
+const dataset_record* dataset_reader::find(uint64 key, Color to_move) const
+{
+    uint64 side = (to_move == Black) ? dataset_file::side_bit : 0;
+    const index_entry* e = std::lower_bound(index, index + n_index, index_entry{ key, side });
+    if (e == index + n_index || e->key != key || (e->record & dataset_file::side_bit) != side)
+        return nullptr;
+    return &records[e->record & ~dataset_file::side_bit];
+}
+
+const dataset_record* dataset_reader::find(const Board& b, Color to_move) const
+{
+    return pos_rank::rankable(b) ? find(prank.rank(b), to_move) : nullptr;
+}
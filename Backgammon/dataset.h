@@ -0,0 +1,132 @@
+#pragma once
+#include <fstream>
+#include <string>
+#include <vector>
+#include "bearoff.h"
+#include "board.h"
+#include "inttyp.h"
+
+/// <summary>
+/// A position of a dataset and its results, for the side to move
+/// </summary>
+struct dataset_record
+{
+	enum Source { none, evaluation, rollout, game };
+
+	uint64	key;			// pos_rank key of the board
+	uint8	to_move;		// Color
+	uint8	dice[2];		// the roll of to_move, 0 before the roll
+	uint8	source;			// Source of the results
+	uint32	games;			// games of a rollout, 1 for a game played
+	float	pwin;
+	float	pwin_se;		// standard errors, 0 for one game
+	float	equity;			// cubeless, gammons included
+	float	equity_se;
+
+	Color	side() const { return Color(to_move); }
+	Board	board() const;
+};
+static_assert(sizeof(dataset_record) == 32, "two records per cache line");
+
+/// <summary>
+/// The record of b, to_move on roll, without dice or results
+/// </summary>
+/// <returns>false if pos_rank can not key b (more than max_bar checkers on a bar)</returns>
+bool	make_record(const Board& b, Color to_move, dataset_record& r);
+
+/// <summary>
+/// File of fixed size records, scanned in place through a mapping.
+///
+/// On disk:
+///		header
+///		dataset_record	records[count]			in the order appended
+///		index_entry		index[index_count]		(key, side, record #) sorted, for find()
+///
+/// The count and the index are written when the writer closes: until then a
+/// reader sees the records there were before (and no index when appending).
+/// </summary>
+struct dataset_file
+{
+	struct header
+	{
+		char	magic[8];		// "BGDATA01"
+		uint32	version;
+		uint32	record_size;
+		uint64	count;			// records
+		uint64	index_count;	// 0 (no index) or count
+	};
+	struct index_entry
+	{
+		uint64	key;
+		uint64	record;			// to_move << 63 | record #
+
+		bool operator< (const index_entry& e) const { return key != e.key ? key < e.key : record < e.record; }
+	};
+	static constexpr uint32 version = 1;
+	static constexpr uint64 side_bit = uint64(1) << 63;
+};
+
+/// <summary>
+/// Appends records to a dataset, a chunk of them per write
+/// </summary>
+struct dataset_writer
+{
+	static const size_t chunk = 1 << 15;	// records
+
+	dataset_writer() = default;
+	~dataset_writer() { close(); }
+	dataset_writer(const dataset_writer&) = delete;
+	dataset_writer& operator=(const dataset_writer&) = delete;
+
+	/// <summary>
+	/// Create the dataset at path, or add to the one there if append
+	/// </summary>
+	/// <param name="index">rebuild the index on close: 16 bytes of memory per record until then</param>
+	bool	open(const std::string& path, bool append = false, bool index = true);
+	bool	is_open() const { return out.is_open(); }
+	bool	append(const dataset_record& r);
+	/// <summary>
+	/// Write the last chunk, the index and the header
+	/// </summary>
+	/// <returns>false if any write failed</returns>
+	bool	close();
+
+	uint64	size() const { return count; }
+
+private:
+	std::fstream							out;
+	std::vector<dataset_record>				buffer;
+	std::vector<dataset_file::index_entry>	index;
+	uint64									count = 0;
+	bool									indexed = false;
+
+	bool	flush();
+};
+
+/// <summary>
+/// Read only view of a dataset: the records are iterated and looked up in the mapping, without copies
+/// </summary>
+struct dataset_reader
+{
+	bool	open(const std::string& path);
+	void	close() { file.close(); n = n_index = 0; }
+
+	uint64					size() const { return n; }
+	const dataset_record*	begin() const { return records; }
+	const dataset_record*	end() const { return records + n; }
+	const dataset_record&	operator[](uint64 i) const { return records[i]; }
+
+	bool					indexed() const { return n_index != 0; }
+	/// <summary>
+	/// First record of the board key, to_move on roll (indexed datasets)
+	/// </summary>
+	/// <returns>nullptr if there is none</returns>
+	const dataset_record*	find(uint64 key, Color to_move) const;
+	const dataset_record*	find(const Board& b, Color to_move) const;
+
+private:
+	mapped_file							file;
+	const dataset_record*				records = nullptr;
+	const dataset_file::index_entry*	index = nullptr;
+	uint64								n = 0, n_index = 0;
+};
@@ -1,20 +1,6 @@
 #include "eg_hash.h"
 #include "board.h"
 
-int64 binom(int64 n, int64 k)
-{
-    k = std::min(k, n - k);
-
-    int64 res = k >= 0; // Ensure correst results for k < 0
-
-    for (int64 i = 0; i < k; ++i)
-        res = res * (n - i) / (i + 1);
-
-    return res;
-}
-
-int64 multichoose(int64 n, int64 k) { return binom(n + k - 1, k); }
-
 eg_hash::Hash eg_hash::hash(const inner_table& b)
 {
     int k = 14;
@@ -28,7 +14,7 @@ eg_hash::Hash eg_hash::hash(const inner_table& b)
     return _hash;
 }
 
-eg_hash::inner_table& eg_hash::inverse_hash(Hash h, inner_table& b)
+eg_hash::inner_table& eg_hash::search_inverse_hash(Hash h, inner_table& b)
 {
     int K = 0;
     Hash H = h; // invariant: H >= 0
@@ -46,6 +32,32 @@ eg_hash::inner_table& eg_hash::inverse_hash(Hash h, inner_table& b)
     return b;
 }
 
+const uint16* eg_hash::steps()
+{
+    static const std::vector<uint16> step = [this] {
+        std::vector<uint16> t(7 * 7 * n_inner_table_configurations);
+        inner_table b;
+        for (Hash h = 0; h < n_inner_table_configurations; ++h)
+        {
+            inverse_hash(h, b);
+            for (int from = 0; from < 7; ++from)
+                for (int to = 0; to < 7; ++to)
+                {
+                    if (b[from] == 0 || from == to)
+                    {
+                        t[7 * 7 * h + 7 * from + to] = uint16(h);  // never used
+                        continue;
+                    }
+                    --b[from]; ++b[to];
+                    t[7 * 7 * h + 7 * from + to] = uint16(hash(b));
+                    ++b[from]; --b[to];
+                }
+        }
+        return t;
+    }();
+    return step.data();
+}
+
 eg_hash::Hash eg_hash::hash_w(const Board& b)
 {
     int k = 14;
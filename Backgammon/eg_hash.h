@@ -2,6 +2,8 @@
 #include <vector>
 #include <array>
 #include <cmath>
+#include <algorithm>
+#include <type_traits>
 #include "inttyp.h"
 
 struct Board;
@@ -11,8 +13,30 @@ constexpr int n_inner_table_configurations = 54264;	// multichoose(7,15)
 
 // Combinatorial functions used
 // in computation of inner table hash
-int64 binom(int64 n, int64 k);
-int64 multichoose(int64 n, int64 k);
+constexpr int64 binom(int64 n, int64 k)
+{
+	k = std::min(k, n - k);
+
+	int64 res = k >= 0; // Ensure correst results for k < 0
+
+	for (int64 i = 0; i < k; ++i)
+		res = res * (n - i) / (i + 1);
+
+	return res;
+}
+
+constexpr int64 multichoose(int64 n, int64 k) { return binom(n + k - 1, k); }
+
+// multichoose(n + 1, k - 1) for n < N, k < K + 2
+template<int N, int K>
+constexpr std::array<std::array<int64, K + 2>, N> multichoose_table()
+{
+	std::array<std::array<int64, K + 2>, N> t{};
+	for (int n = 0; n < N; ++n)
+		for (int k = 0; k < K + 2; ++k)
+			t[n][k] = multichoose(n + 1, k - 1);
+	return t;
+}
 
 // singleton class
 struct eg_hash 
@@ -24,13 +48,32 @@ struct eg_hash
 	static const int n_pre = 7;
 	static const int k_pre = 15;
 
-	std::array<std::array<int64,k_pre + 2>, n_pre> multi_choose;
+	static constexpr std::array<std::array<int64,k_pre + 2>, n_pre> multi_choose = multichoose_table<n_pre, k_pre>();
+
+	// Inner table of each hash, 4 bits per point (point i in bits 4i..4i+3)
+	using Packed = uint32;
+	std::vector<Packed> unhash;
 
 	eg_hash()
 	{
-		for (int n = 0; n < DIM(multi_choose); ++n)
-			for (int k = 0; k < DIM(multi_choose[0]); ++k)
-				multi_choose[n][k] = multichoose(n + 1, k - 1);
+		inner_table b;
+		unhash.resize(n_inner_table_configurations);
+		for (Hash h = 0; h < n_inner_table_configurations; ++h)
+			unhash[h] = pack(search_inverse_hash(h, b));
+	}
+
+	static Packed pack(const inner_table& b)
+	{
+		Packed p = 0;
+		for (int i = 0; i < 7; ++i)
+			p |= Packed(b[i]) << (4 * i);
+		return p;
+	}
+	static inner_table& unpack(Packed p, inner_table& b)
+	{
+		for (int i = 0; i < 7; ++i)
+			b[i] = (p >> (4 * i)) & 0xf;
+		return b;
 	}
 
 	/// <summary>
@@ -40,14 +83,14 @@ struct eg_hash
 	/// <param name="n">1..7</param>
 	/// <param name="k">-1..15</param>
 	/// <returns></returns>
-	int64 mc(int64 n, int64 k) 
+	static int64 mc(int64 n, int64 k) 
 	{ 
 		Assert(1 <= n && n <= n_pre && -1 <= k && k <= k_pre);
 		//Assert(multichoose(n, k) == multi_choose[n - 1][k + 1]);
 		return multi_choose[n - 1][k + 1];
 	}
 
-	Hash S(int64 i, int64 K) { return mc(7 - i, 15 - (K + 1)); }
+	static Hash S(int64 i, int64 K) { return mc(7 - i, 15 - (K + 1)); }
 
 	/// <summary>
 	/// Compute perfect hash of the inner table b
@@ -66,7 +109,24 @@ struct eg_hash
 	/// <param name="h">input hash code</param>
 	/// <param name="b">output inner_table</param>
 	/// <returns>b</returns>
-	inner_table&	inverse_hash(Hash h, inner_table& b);
+	inner_table&	inverse_hash(Hash h, inner_table& b) const
+	{
+		Assert(0 <= h && h < n_inner_table_configurations);
+		return unpack(unhash[h], b);
+	}
+
+	/// <summary>
+	/// Hash after moving one checker between two slots of the inner table,
+	/// steps()[7 * 7 * h + 7 * from + to] (slot 0 finished, slot i pip 25-i).
+	/// 5.3 MB built on the first call, once: only bearoff move generation needs it.
+	/// </summary>
+	const uint16*	steps		();
+
+	/// <summary>
+	/// Invert the hash function searching the multichoose coefficients
+	/// (used to build the unhash table)
+	/// </summary>
+	inner_table&	search_inverse_hash(Hash h, inner_table& b);
 
 	/// <summary>
 	/// Compute hash of the inner table of white pieces
@@ -79,8 +139,40 @@ struct eg_hash
 
 extern struct eg_hash eg;	// singleton instance
 
+static_assert(multichoose(7, 15) == n_inner_table_configurations, "inner table configurations");
+
+static_assert(n_inner_table_configurations <= 0x10000, "eg_hash::steps() holds hashes in 16 bits");
+
+/// <summary>
+/// Inner table hash of the side to move, updated by eg.steps() deltas while
+/// the moves of a bare off position are generated (MoveContainer moved/unmoved
+/// protocol, see board.h). Pips are relative to the side to move, 25 is off.
+/// </summary>
+struct inner_hash
+{
+	using Hash = eg_hash::Hash;
+	Hash			hash;
+	const uint16*	step;
+
+	inner_hash(Hash h) : hash(h), step(eg.steps()) {}
+
+	static int slot(int pip) { Assert(pip > 18); return pip < 25 ? 25 - pip : 0; }
+
+	// Hash after a checker moves from slot 'from' to slot 'to'
+	Hash move(int from, int to) const
+	{
+		Assert(0 <= hash && hash < n_inner_table_configurations && 0 <= from && from < 7 && 0 <= to && to < 7);
+		return step[7 * 7 * hash + 7 * from + to];
+	}
+
+	// MoveContainer interface
+	void moved(int from, int to)	{ hash = move(slot(from), slot(to)); }
+	void unmoved(int from, int to)	{ hash = move(slot(to), slot(from)); }
+};
+
 /// <summary>
-/// Iterator over inner table checker configurations in eg_hash hash order
+/// Iterator over inner table checker configurations in eg_hash hash order.
+/// Trivially copyable: each step unpacks the next entry of eg.unhash.
 /// </summary>
 struct inner_table_iterator
 {
@@ -91,21 +183,14 @@ struct inner_table_iterator
 	static const Hash max_index = n_inner_table_configurations - 1;;
 
 	Hash _hash;
-	std::vector<int> stack;
 	inner_table checkers;
 
 	bool more() { return _hash < max_index; }
 
-	void set_stack() {
-		stack.clear(); stack.reserve(8);
-		for (int i = 0; i < 7; ++i)
-			if (checkers[i] > 0)
-				stack.push_back(i);
-	}
 	/// <summary>
 	/// Initialize to 0th position -- all checkers finished
 	/// </summary>
-	inner_table_iterator() : _hash(0), checkers{ k, 0, 0, 0, 0, 0, 0 } { stack.reserve(8); stack.push_back(0); }
+	inner_table_iterator() : _hash(0), checkers{ k, 0, 0, 0, 0, 0, 0 } {}
 
 	/// <summary>
 	/// Initialize to position with hash = n
@@ -114,7 +199,6 @@ struct inner_table_iterator
 	inner_table_iterator(Hash n) : _hash(n)
 	{
 		eg.inverse_hash(n, checkers);
-		set_stack();
 	}
 
 	Hash seq_index() { return _hash; }
@@ -124,31 +208,9 @@ struct inner_table_iterator
 		if (++_hash >= n_inner_table_configurations)
 			return *this;
 
-		int& last = stack.back();
-		if (last < 6)
-		{
-			checkers[last + 1] = 1;
-			if (--checkers[last] > 0)
-				stack.push_back(last + 1);
-			else
-				++last;
-		}
-		else
-		{
-			int c = checkers[6];
-			checkers[6] = 0;
-			stack.pop_back();
-			Assert(!stack.empty());
-			int& prev = stack.back();
-			Assert(prev >= 0 && prev < 6);
-			checkers[prev + 1] = c + 1;
-			if (--checkers[prev] > 0)
-				stack.push_back(prev + 1);
-			else
-				++prev;
-
-		}
+		eg.inverse_hash(_hash, checkers);
 		Assert(_hash == eg.hash(checkers));
 		return *this;
 	}
-};
\ No newline at end of file
+};
+static_assert(std::is_trivially_copyable<inner_table_iterator>::value, "inner_table_iterator is copied by value");
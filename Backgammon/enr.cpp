@@ -15,11 +15,12 @@ std::ostream& operator<<(std::ostream& s, const finite_support_vector& v)
 /// <summary>
 /// Accumulate the minimum of the compute_enr (looked up in enr vector) 
 /// of the boards pushed.
+/// The inner_hash base follows the moves of the generator from the hash of the root board.
 /// </summary>
-struct minENR {
+struct minENR : inner_hash {
     using enrvec = ENR::enrvec;
 
-    minENR(const enrvec& enr) : enr(enr), min_enr(std::numeric_limits<float>::infinity()) {}
+    minENR(const enrvec& enr, Hash root) : inner_hash(root), enr(enr), min_enr(std::numeric_limits<float>::infinity()) {}
 
     const enrvec& enr;
     float min_enr;
@@ -27,33 +28,34 @@ struct minENR {
     // MoveContainer interface 
     void push_board(const Board& b)
     {
-        min_enr = std::min(min_enr, enr[eg.hash_w(b)]);
+        Assert(hash == eg.hash_w(b));
+        min_enr = std::min(min_enr, enr[hash]);
     }
+    // ENR >= 0: nothing beats a move baring off every checker
+    bool stop() const { return min_enr <= 0; }
 };
 
 /// <summary>
 /// Store the hash of the least ENR board
 /// </summary>
-struct minENRhash {
-    using Hash = ENR::Hash;
+struct minENRhash : inner_hash {
+    minENRhash(const ENR::enrvec& enr, Hash root) : inner_hash(root), enr(enr), min_enr(std::numeric_limits<float>::infinity()), best(0) {}
 
-    minENRhash(const ENR& enr) : enr(enr), min_enr(std::numeric_limits<float>::infinity()), hash(0) {}
-
-    const ENR& enr;
+    const ENR::enrvec& enr;
     float min_enr;
-    Hash hash;
+    Hash best;
 
     // MoveContainer interface 
     void push_board(const Board& b)
     {
-        Hash h = eg.hash_w(b);
-
-        if (min_enr > enr[h])
+        Assert(hash == eg.hash_w(b));
+        if (min_enr > enr[hash])
         {
-            min_enr = enr[h];
-            hash = h;
+            min_enr = enr[hash];
+            best = hash;
         }
     }
+    bool stop() const { return min_enr <= 0; }
 };
 /// <summary>
 /// Compute compute_enr for Board 'b' having rolled 'r'
@@ -64,7 +66,7 @@ struct minENRhash {
 float ENR::compute_enr(BoardInfo& b, const Roll& r)
 {
     // find minimum compute_enr over possible moves with roll 'r'
-    minENR minenr(enr);
+    minENR minenr(enr, eg.hash_w(b));
     //b.genMoves(minenr, b.get_Info(), r.hi, r.lo);
     genMoves(minenr, b, r);
     return 1.0 + minenr.min_enr;;
@@ -108,16 +110,17 @@ void ENR::compute_enr()
 }
 
 /// <summary>
-/// Hash of best move using min ENR strategy
+/// Hash of best move: the least expectation e
 /// </summary>
 /// <param name="b"></param>
 /// <param name="r"></param>
+/// <param name="e">expectation of each inner table position</param>
 /// <returns></returns>
-ENR::Hash ENR::bestMove(BoardInfo& b, const Roll& r) const
+ENR::Hash ENR::bestMove(BoardInfo& b, const Roll& r, const enrvec& e) const
 {
-    minENRhash minhash(*this);
+    minENRhash minhash(e, eg.hash_w(b));
     genMoves(minhash, b, r);
-    return minhash.hash;
+    return minhash.best;
 }
 
 /// <summary>
@@ -127,28 +130,38 @@ ENR::Hash ENR::bestMove(BoardInfo& b, const Roll& r) const
 /// </summary>
 /// <param name="b"></param>
 void PNR::computeXden(BoardInfo& b)
+{
+    computeDen(b, X, enr);
+}
+
+/// <summary>
+/// for board b
+/// Append to D the density of b, when playing the moves of least expectation e,
+/// from the densities D of those moves
+/// </summary>
+void PNR::computeDen(BoardInfo& b, std::vector<Dist>& D, const enrvec& e)
 {
     std::array<Hash, 21> H;     // The hash of the best move for each roll
     size_t lo = 100, hi = 0;    // Low and High bounds for density being computed
 
-    // Find best move for each roll and retrieve X density
+    // Find best move for each roll and retrieve its density
     // Determine support (lo,hi) bounds for output density.
     for (auto& r : Roll::rolls21)
     {
-        H[r.ordinal] = bestMove(b, r);
-        Dist& den = X[H[r.ordinal]];
+        H[r.ordinal] = bestMove(b, r, e);
+        Dist& den = D[H[r.ordinal]];
         lo = std::min(lo, den.lower());
         hi = std::max(hi, den.upper());
     }
 
-    // Append new density vector to end of Xdist
-    X.emplace_back(hi, lo);
-    Dist& den_b = X.back(); // The density of the X for board b
+    // Append new density vector to end of D
+    D.emplace_back(hi, lo);
+    Dist& den_b = D.back(); // The density for board b
     Assert(den_b.support[hi - lo - 1] == 0.0);
 
     for (auto& r : Roll::rolls21)
     {
-        Dist& den_r = X[H[r.ordinal]];      // density of best move for roll r
+        Dist& den_r = D[H[r.ordinal]];      // density of best move for roll r
         int j = den_r.lower() - den_b.lower();
         for (float d : den_r.support)
         {
@@ -190,6 +203,36 @@ void PNR::computeXdist()
         dist.distribution();
 }
 
+/// <summary>
+/// for each inner board configuration
+/// Compute distribution: P(Y<=n) of the random variable Y
+/// Y=n -- Player p bares off its first checker in <n> moves
+/// </summary>
+void PNR::computeYdist()
+{
+    inner_table_iterator it;
+    Y.clear();
+    Y.reserve(inner_table_iterator::max_index + 1);
+    eoff.clear();
+    eoff.reserve(inner_table_iterator::max_index + 1);
+    Y.emplace_back(1.0);    // Emplace the finish position: P(Y=0) = 1.0
+    eoff.push_back(0.0);
+
+    while (it.more())
+    {
+        if ((*++it)[0] > 0)
+            Y.emplace_back(1.0);    // A checker is already off
+        else
+        {
+            BoardInfo B(*it);
+            computeDen(B, Y, eoff);
+        }
+        eoff.push_back(Y.back().mean());
+    }
+    for (auto& dist : Y)
+        dist.distribution();
+}
+
 /// <summary>
 /// The Win probability of player to move
 /// when both players use min ENR strategy
@@ -215,4 +258,31 @@ float PNR::Pwin(Hash hw, Hash hb)
     }
     pwin += (1.0 - db);
     return pwin;
+}
+
+// P(X <= n) of the distribution d (at() takes n < 0 for a huge size_t)
+static float cdf(finite_support_vector& d, int n) { return n < 0 ? 0.0 : d.at(n); }
+
+float PNR::Pgammon(Hash hw, Hash hb)
+{
+    Dist& Xw = X[hw];   // player to move
+    Dist& Yb = Y[hb];   // opponent
+
+    // Finishing on turn n, after the opponent's n-1 turns: a gammon if Yb >= n
+    float p = 0.0;
+    for (int n = Xw.lower(); n < int(Xw.upper()); ++n)
+        p += (cdf(Xw, n) - cdf(Xw, n - 1)) * (1.0 - cdf(Yb, n - 1));
+    return p;
+}
+
+float PNR::Plose_gammon(Hash hw, Hash hb)
+{
+    Dist& Yw = Y[hw];   // player to move
+    Dist& Xb = X[hb];   // opponent
+
+    // The opponent finishes on its turn m, after our m turns: a gammon if Yw > m
+    float p = 0.0;
+    for (int m = Xb.lower(); m < int(Xb.upper()); ++m)
+        p += (cdf(Xb, m) - cdf(Xb, m - 1)) * (1.0 - cdf(Yw, m));
+    return p;
 }
\ No newline at end of file
@@ -31,6 +31,14 @@ struct finite_support_vector
 
 	// Increment offset by 1 to shift the domain of the distribution
 	size_t  shift() { return ++offset; }
+	// Expectation of a density
+	double  mean() const
+	{
+		double e = 0.0;
+		for (size_t i = 0; i < support.size(); ++i)
+			e += (offset + i) * support[i];
+		return e;
+	}
 	// Convert density to distribution
 	void    distribution()
 	{
@@ -70,7 +78,11 @@ struct ENR {
 	/// <param name="b"></param>
 	/// <param name="r"></param>
 	/// <returns>Hash of best move using min ENR strategy</returns>
-	Hash    bestMove(BoardInfo& b, const Roll& r) const;
+	Hash    bestMove(BoardInfo& b, const Roll& r) const { return bestMove(b, r, enr); }
+	/// <summary>
+	/// compute hash of the move to the position of least expectation e
+	/// </summary>
+	Hash    bestMove(BoardInfo& b, const Roll& r, const enrvec& e) const;
 
 	/// <summary>
 	/// E[X]
@@ -86,6 +98,10 @@ struct ENR {
 /// The Expectation and Probability distribution of the
 /// random variable X where X=n is the event that a player
 /// bares off in n turns when always choosing min ENR moves.
+///
+/// For gammons, the distribution of Y where Y=n is the event that
+/// the player bares off its first checker in n turns, when choosing
+/// the moves of least E[Y].
 /// </summary>
 struct PNR : ENR
 {
@@ -93,13 +109,18 @@ struct PNR : ENR
 	using Hash = ENR::Hash;
 
 	std::vector<Dist> X;
+	std::vector<Dist> Y;
+	enrvec eoff;		// E[Y]
 
-	PNR() : ENR() { computeXdist(); }
+	PNR() : ENR() { computeXdist(); computeYdist(); }
 
 	// Initializers
 	void computeXdist();
 	void computeXden();
 	void computeXden(BoardInfo& b);
+	void computeYdist();
+	// Append to D the density of b: the mix of the densities of the moves of least e
+	void computeDen(BoardInfo& b, std::vector<Dist>& D, const enrvec& e);
 
 	/// <summary>
 	/// The Win probability of player to move
@@ -110,14 +131,15 @@ struct PNR : ENR
 	/// <returns>P(player to move wins)</returns>
 	float Pwin(Hash to_move, Hash opp);
 	float Pwin(eg_hash::BwHash h) { return Pwin(h.first, h.second); }
-};
 
-/// <summary>
-/// for each inner table position
-/// The Expectation and Probability distribution of the
-/// random variable X where X=n is the event that a player
-/// bares off in n turns when always choosing min ENR moves.
-/// 
-/// The singleton instance of struct PNR;
-/// </summary>
-extern struct PNR Pnr;
+	/// <summary>
+	/// The probability that the player to move wins a gammon:
+	/// it finishes before the opponent bares off a checker
+	/// </summary>
+	float Pgammon(Hash to_move, Hash opp);
+	/// <summary>
+	/// The probability that the player to move loses a gammon:
+	/// the opponent finishes before it bares off a checker
+	/// </summary>
+	float Plose_gammon(Hash to_move, Hash opp);
+};
@@ -1,10 +1,10 @@
 #include "scm.h"
 #include "board.h"
 #include "eval.h"
+#include "packedboard.h"
 
 struct eg_hash eg;  // singleton
-PNR Pnr;
-p_exact exact;  // singleton
+eval_context evaluation;  // singleton
 
 bool Board::bareoffB() const
 {
@@ -26,20 +26,254 @@ bool Board::bareoffW() const
 
 bool Board::bareoff_race()		const
 {
-	// Use pip count to filter pointless bareoff tests.
-	return pipB() <= 6 * 15 && pipW() <= 6 * 15
-		&& bareoffB() && bareoffW();
+	return (position_class() & Bareoff) != 0;
 }
 
-float Board::endgame_eval(bool& terminal) const
+float Board::endgame_eval(bool& terminal, Color to_move) const
 {
 	const auto min_finished = 15 - p_exact::n;
-	auto h = eg.hash_bw(*this);
-	return (finishedW() >= min_finished && finishedB() >= min_finished)
-		? terminal=true, exact.Pwin(h) : terminal=false, Pnr.Pwin(h);
+	auto h = eg.hash_bw(*this);		// (Black, White)
+	if (to_move == White)
+		std::swap(h.first, h.second);
+	terminal = (finishedW() >= min_finished && finishedB() >= min_finished);
+	return terminal ? evaluation.exact().Pwin(h) : evaluation.pnr().Pwin(h);
 }
 
-float Board::eval(bool& terminal)		const
+Outcome Board::race_outcome(Color to_move) const
 {
-	return bareoff_race() ? endgame_eval(terminal) : terminal=false, ScmPwin(pipW(), pipB());
-}
\ No newline at end of file
+	Assert(bareoff_race());
+	PNR& pnr = evaluation.pnr();
+	auto h = eg.hash_bw(*this);		// (Black, White)
+	if (to_move == White)
+		std::swap(h.first, h.second);
+	bool terminal;
+	Outcome o;
+	o.win = endgame_eval(terminal, to_move);
+	o.win_gammon = pnr.Pgammon(h.first, h.second);
+	o.lose_gammon = pnr.Plose_gammon(h.first, h.second);
+	// No backgammons: every checker is in its own inner board
+	o.win_backgammon = o.lose_backgammon = 0;
+	return o;
+}
+
+// Correction of the wastage of the outside checkers stacked on the 6 point,
+// by # of outside checkers: they reach the inner board spread over its points.
+// Mean error of the stacked model against the 10 point bearoff database.
+static constexpr std::array<float, 16> outside_wastage = {
+	0.00f, 0.07f, 0.32f, 0.16f, 0.14f, -0.14f, -0.28f, -0.59f,
+	-0.78f, -1.08f, -1.26f, -1.51f, -1.67f, -1.90f, -2.02f, -2.31f,
+};
+
+template<Color C>
+static float effective_pips(const Board& b, const ENR& enr)
+{
+	// Inner table of C (slot 0 finished, slot i pip 25-i)
+	// with the outside checkers stacked on the 6 point
+	eg_hash::inner_table t;
+	t[0] = b.finished<C>();
+	int inner = t[0], inner_pips = 0;
+	for (int i = 1; i <= 6; ++i)
+	{
+		t[i] = std::max(0, b.pt<C>(25 - i));
+		inner += t[i];
+		inner_pips += i * t[i];
+	}
+	int n_out = 15 - inner;
+	t[6] += n_out;
+	int pips = (C == White) ? b.pipW() : b.pipB();
+	return pips_per_roll * enr[eg.hash(t)] + (pips - inner_pips - 6 * n_out) + outside_wastage[n_out];
+}
+
+float Board::effective_pips(Color c)	const
+{
+	const ENR& enr = evaluation.pnr();
+	return (c == White) ? ::effective_pips<White>(*this, enr) : ::effective_pips<Black>(*this, enr);
+}
+
+uint32 Board::position_class()	const
+{
+	return PackedBoard(*this).position_class();
+}
+
+namespace {
+
+// Evaluation kernels, chosen by the PositionClass of the board
+enum Kernel { k_exact, k_pnr, k_bearoff, k_race, k_net, k_pips, n_kernels };
+
+Kernel kernel(uint32 c, bool ready, const nn_eval* net)
+{
+	if (!ready)
+		return k_pips;	// the tables are being built
+	if (!(c & Race))
+		return net ? k_net : k_pips;	// the race evaluator is for races only
+	return (c & Exact) ? k_exact : (c & Bareoff) ? k_pnr : (c & Bearoff10) ? k_bearoff : k_race;
+}
+
+// The contact evaluator, once the tables are ready
+const nn_eval* contact_net(bool ready)
+{
+	return ready ? evaluation.net() : nullptr;
+}
+
+// (to move, opponent) inner board hashes
+eg_hash::BwHash inner_hashes(const Board& b, Color to_move)
+{
+	auto h = eg.hash_bw(b);		// (Black, White)
+	if (to_move == White)
+		std::swap(h.first, h.second);
+	return h;
+}
+
+float race_pwin(const Board& b, Color to_move, const ENR& enr)
+{
+	float x = (to_move == White) ? effective_pips<White>(b, enr) : effective_pips<Black>(b, enr);
+	float y = (to_move == White) ? effective_pips<Black>(b, enr) : effective_pips<White>(b, enr);
+	return ScmPwin(ScmStat(x, y));
+}
+
+// The evaluation f() of the board b through the cache
+template<class F>
+float cached(const Board& b, Color to_move, F f)
+{
+	eval_cache& cache = evaluation.cache();
+	if (!cache.enabled())
+		return f();
+	uint64 key = eval_cache::key(b, to_move);
+	float p;
+	if (!cache.probe(key, p))
+		cache.store(key, p = f());
+	return p;
+}
+
+// Remove from the group g the boards found in the cache, setting their p;
+// keys: the keys of the boards left, to store their evaluations
+void probe_group(std::vector<uint32>& g, const Board* boards, float* p, Color to_move, std::vector<uint64>& keys)
+{
+	keys.clear();
+	eval_cache& cache = evaluation.cache();
+	if (!cache.enabled())
+		return;
+	// All the keys first, their buckets prefetched, then the probes
+	for (uint32 i : g)
+	{
+		keys.push_back(eval_cache::key(boards[i], to_move));
+		cache.prefetch(keys.back());
+	}
+	size_t m = 0;
+	for (size_t j = 0; j < g.size(); ++j)
+		if (!cache.probe(keys[j], p[g[j]]))
+		{
+			g[m] = g[j];
+			keys[m++] = keys[j];
+		}
+	g.resize(m);
+	keys.resize(m);
+}
+
+void store_group(const std::vector<uint32>& g, const float* p, const std::vector<uint64>& keys)
+{
+	eval_cache& cache = evaluation.cache();
+	for (size_t j = 0; j < keys.size(); ++j)
+		cache.store(keys[j], p[g[j]]);
+}
+
+float pips_pwin(const Board& b, Color to_move)
+{
+	return (to_move == Black) ? ScmPwin(b.pipW(), b.pipB()) : ScmPwin(b.pipB(), b.pipW());
+}
+
+}
+
+float Board::race_eval(Color to_move)	const
+{
+	return race_pwin(*this, to_move, evaluation.pnr());
+}
+
+float Board::eval(bool& terminal, Color to_move)		const
+{
+	bool ready = evaluation.ready();
+	const nn_eval* net = contact_net(ready);
+	Kernel k = kernel(position_class(), ready, net);
+	terminal = (k == k_exact);
+	switch (k)
+	{
+	case k_net:
+		return cached(*this, to_move, [&] { return net->Pwin(*this, to_move); });
+	case k_exact:
+		return evaluation.exact().Pwin(inner_hashes(*this, to_move));
+	case k_pnr:
+		return evaluation.pnr().Pwin(inner_hashes(*this, to_move));
+	case k_bearoff:
+		// Races on the last 10 points: one-sided bearoff database
+		if (const bearoff_db* db = evaluation.bearoff())
+			return cached(*this, to_move, [&] { return db->Pwin(*this, to_move); });
+		// fall through
+	case k_race:
+		// Effective pip counts from the ENR table
+		return race_pwin(*this, to_move, evaluation.pnr());
+	default:
+		return pips_pwin(*this, to_move);
+	}
+}
+
+void Board::eval(const Board* boards, size_t n, float* p, Color to_move)
+{
+	// Group the boards by kernel, then run each kernel over its group
+	thread_local std::array<std::vector<uint32>, n_kernels> group;
+	thread_local std::vector<uint64> keys;
+	for (auto& g : group)
+		g.clear();
+	bool ready = evaluation.ready();
+	const nn_eval* net = contact_net(ready);
+	for (size_t i = 0; i < n; ++i)
+		group[kernel(boards[i].position_class(), ready, net)].push_back(uint32(i));
+
+	if (!group[k_exact].empty())
+	{
+		p_exact& exact = evaluation.exact();
+		for (uint32 i : group[k_exact])
+			p[i] = exact.Pwin(inner_hashes(boards[i], to_move));
+	}
+	if (!group[k_pnr].empty())
+	{
+		PNR& pnr = evaluation.pnr();
+		for (uint32 i : group[k_pnr])
+			p[i] = pnr.Pwin(inner_hashes(boards[i], to_move));
+	}
+	if (!group[k_bearoff].empty())
+	{
+		if (const bearoff_db* db = evaluation.bearoff())
+		{
+			probe_group(group[k_bearoff], boards, p, to_move, keys);
+			for (uint32 i : group[k_bearoff])
+				p[i] = db->Pwin(boards[i], to_move);
+			store_group(group[k_bearoff], p, keys);
+		}
+		else
+			group[k_race].insert(group[k_race].end(), group[k_bearoff].begin(), group[k_bearoff].end());
+	}
+	if (!group[k_net].empty())
+		probe_group(group[k_net], boards, p, to_move, keys);
+	if (!group[k_net].empty())
+	{
+		// Encode the boards not in the cache, then run the net over all of them
+		thread_local std::vector<float> X, Y;
+		size_t m = group[k_net].size();
+		X.resize(m * nn_eval::n_inputs);
+		Y.resize(m * nn_eval::n_outputs);
+		for (size_t j = 0; j < m; ++j)
+			nn_eval::encode(boards[group[k_net][j]], to_move, &X[j * nn_eval::n_inputs]);
+		net->forward(X.data(), m, Y.data());
+		for (size_t j = 0; j < m; ++j)
+			p[group[k_net][j]] = Y[j * nn_eval::n_outputs];
+		store_group(group[k_net], p, keys);
+	}
+	if (!group[k_race].empty())
+	{
+		const ENR& enr = evaluation.pnr();
+		for (uint32 i : group[k_race])
+			p[i] = race_pwin(boards[i], to_move, enr);
+	}
+	for (uint32 i : group[k_pips])
+		p[i] = pips_pwin(boards[i], to_move);
+}
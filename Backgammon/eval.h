@@ -1,7 +1,172 @@
 #pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 #include "enr.h"
 #include "pwinx.h"
+#include "cube.h"
+#include "bearoff.h"
+#include "nn.h"
+#include "eval_cache.h"
 
 extern	struct eg_hash eg;  // singleton
-extern	PNR Pnr;
-extern	p_exact exact;  // singleton
\ No newline at end of file
+
+// singleton class
+/// <summary>
+/// The tables of the bearoff evaluation: PNR (min ENR strategy), p_exact,
+/// its cubeful equities and the one-sided bearoff database of races on the
+/// last 10 points; the weights of the contact evaluator, and the cache of
+/// the evaluations of the contact net and of the bearoff database.
+/// Each table is built on its first use, once, whichever thread asks first;
+/// the bearoff database is mapped from its file (see build_bearoff).
+///
+/// warm_up() builds them in a background thread instead; until it is done
+/// ready() is false and Board::eval falls back to the Single Checker Model,
+/// so callers need not wait for the tables; wait() does, for callers whose
+/// results must not depend on the timing.
+/// </summary>
+struct eval_context
+{
+	eval_context() : warming(false), built(false) {}
+	~eval_context() { if (warmer.joinable()) warmer.join(); }
+
+	/// <summary>
+	/// Min ENR strategy table, built on first use
+	/// </summary>
+	PNR&		pnr()
+	{
+		std::call_once(pnr_once, [this] { _pnr.reset(new PNR()); });
+		return *_pnr;
+	}
+
+	/// <summary>
+	/// Exact win probabilities of the late bearoff, built on first use
+	/// </summary>
+	p_exact&	exact()
+	{
+		std::call_once(exact_once, [this] { _exact.reset(new p_exact()); });
+		return *_exact;
+	}
+
+	/// <summary>
+	/// Exact cubeful equities of the late bearoff, built on first use
+	/// </summary>
+	cube_exact&	cube()
+	{
+		std::call_once(cube_once, [this] { _cube.reset(new cube_exact()); });
+		return *_cube;
+	}
+
+	/// <summary>
+	/// File of the bearoff database, and whether a missing one is built on the
+	/// first bearoff() (about 90 s, in the caller or the warm up thread). Set
+	/// them before the first bearoff() or warm_up(). Without the database, races
+	/// on the last 10 points are evaluated like other races.
+	/// </summary>
+	std::string	bearoff_path = bearoff_db::default_path;
+	bool		build_bearoff = false;
+
+	/// <summary>
+	/// One-sided 10 point bearoff database, mapped from bearoff_path on first use.
+	/// A database built there is written to bearoff_path, and kept in memory
+	/// when the file can not be written.
+	/// </summary>
+	/// <returns>nullptr if the database is missing and not built</returns>
+	const bearoff_db*	bearoff()
+	{
+		std::call_once(bearoff_once, [this] {
+			std::unique_ptr<bearoff_db> db(new bearoff_db());
+			if (!db->open(bearoff_path) && build_bearoff)
+			{
+				db->build();
+				db->save(bearoff_path);
+			}
+			if (!db->empty())
+				_bearoff = std::move(db);
+		});
+		return _bearoff.get();
+	}
+
+	/// <summary>
+	/// Precision of the contact evaluator: set it before the first net() or warm_up()
+	/// </summary>
+	nn_eval::Precision	net_precision = nn_eval::Float;
+
+	/// <summary>
+	/// Contact evaluator, loaded from nn_eval::default_path on first use
+	/// </summary>
+	/// <returns>nullptr if there are no weights</returns>
+	const nn_eval*	net()
+	{
+		std::call_once(net_once, [this] {
+			std::unique_ptr<nn_eval> nn(new nn_eval());
+			if (nn->load(nn_eval::default_path, net_precision))
+				_net = std::move(nn);
+		});
+		return _net.get();
+	}
+
+	/// <summary>
+	/// Size of the evaluation cache in megabytes: set it before the first cache() or eval (0: no cache)
+	/// </summary>
+	size_t	cache_mb = eval_cache::default_mb;
+
+	/// <summary>
+	/// Cache of the contact and bearoff database evaluations, allocated on first use
+	/// </summary>
+	eval_cache&	cache()
+	{
+		std::call_once(cache_once, [this] { _cache.reset(new eval_cache(cache_mb)); });
+		return *_cache;
+	}
+
+	/// <summary>
+	/// Start building the tables in a background thread (at most once)
+	/// </summary>
+	void warm_up()
+	{
+		std::lock_guard<std::mutex> lock(warm_mutex);
+		if (warming)
+			return;
+		warming = true;
+		warmer = std::thread([this] { pnr(); exact(); cube(); bearoff(); net(); built = true; });
+	}
+
+	/// <summary>
+	/// Can the tables be used without waiting for the warm up thread
+	/// </summary>
+	bool ready() const { return !warming || built; }
+
+	/// <summary>
+	/// Wait for the warm up thread, if one was started, to finish the tables
+	/// </summary>
+	void wait()
+	{
+		std::lock_guard<std::mutex> lock(warm_mutex);
+		if (warmer.joinable())
+			warmer.join();
+	}
+
+private:
+	std::once_flag				pnr_once;
+	std::once_flag				exact_once;
+	std::once_flag				cube_once;
+	std::once_flag				bearoff_once;
+	std::once_flag				net_once;
+	std::once_flag				cache_once;
+	std::unique_ptr<PNR>		_pnr;
+	std::unique_ptr<p_exact>	_exact;
+	std::unique_ptr<cube_exact>	_cube;
+	std::unique_ptr<bearoff_db>	_bearoff;
+	std::unique_ptr<nn_eval>	_net;
+	std::unique_ptr<eval_cache>	_cache;
+
+	std::mutex					warm_mutex;
+	std::thread					warmer;
+	std::atomic<bool>			warming;
+	std::atomic<bool>			built;
+};
+
+extern eval_context evaluation;	// singleton instance
@@ -0,0 +1,136 @@
+#include <cstring>
+#include "eval_cache.h"
+#include "packedboard.h"
+
+namespace {
+
+const uint64 valid_bit = uint64(1) << 32;
+
+inline uint64 pack(float p)
+{
+    uint32 bits;
+    std::memcpy(&bits, &p, sizeof bits);
+    return valid_bit | bits;
+}
+
+inline float unpack(uint64 data)
+{
+    uint32 bits = uint32(data);
+    float p;
+    std::memcpy(&p, &bits, sizeof p);
+    return p;
+}
+
+// Finalizer of MurmurHash3
+inline uint64 fmix64(uint64 h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+}
+
+void eval_cache::resize(size_t mb)
+{
+    size_t n = mb * (size_t(1) << 20) / sizeof(bucket);
+    n_buckets = 0;
+    buckets.reset();
+    if (n == 0)
+        return;
+    for (n_buckets = 1; 2 * n_buckets <= n; n_buckets *= 2)
+        ;
+    buckets.reset(new bucket[n_buckets]);
+    clear();
+}
+
+void eval_cache::clear()
+{
+    for (size_t i = 0; i < n_buckets; ++i)
+        for (auto& e : buckets[i].e)
+        {
+            e.check.store(0, std::memory_order_relaxed);
+            e.data.store(0, std::memory_order_relaxed);
+        }
+    for (auto& c : count)
+    {
+        c.hits.store(0, std::memory_order_relaxed);
+        c.misses.store(0, std::memory_order_relaxed);
+    }
+}
+
+int eval_cache::shard()
+{
+    static std::atomic<int> next{ 0 };
+    thread_local int s = next.fetch_add(1, std::memory_order_relaxed) % shards;
+    return s;
+}
+
+uint64 eval_cache::hits() const
+{
+    uint64 n = 0;
+    for (auto& c : count)
+        n += c.hits.load(std::memory_order_relaxed);
+    return n;
+}
+
+uint64 eval_cache::misses() const
+{
+    uint64 n = 0;
+    for (auto& c : count)
+        n += c.misses.load(std::memory_order_relaxed);
+    return n;
+}
+
+uint64 eval_cache::key(const Board& b, Color to_move)
+{
+    // The 28 bytes of the packed board (28..31 are 0), then the side to move
+    alignas(32) uint64 w[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(w), PackedBoard(b).v);
+    uint64 h = (to_move == White) ? 0x9e3779b97f4a7c15ull : 0;
+    for (uint64 x : w)
+        h = fmix64(h ^ x);
+    return h;
+}
+
+bool eval_cache::probe(uint64 key, float& p)
+{
+    for (auto& e : find(key).e)
+    {
+        uint64 data = e.data.load(std::memory_order_relaxed);
+        if ((e.check.load(std::memory_order_relaxed) ^ data) == key && (data & valid_bit))
+        {
+            p = unpack(data);
+            count[shard()].hits.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    count[shard()].misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void eval_cache::store(uint64 key, float p)
+{
+    bucket& b = find(key);
+    entry* slot = nullptr;
+    for (auto& e : b.e)
+    {
+        uint64 data = e.data.load(std::memory_order_relaxed);
+        if ((e.check.load(std::memory_order_relaxed) ^ data) == key)
+        {
+            slot = &e;
+            break;
+        }
+        if (!slot && !(data & valid_bit))
+            slot = &e;
+    }
+    if (!slot)
+        slot = &b.e[key >> 62];
+
+    uint64 data = pack(p);
+    slot->check.store(key ^ data, std::memory_order_relaxed);
+    slot->data.store(data, std::memory_order_relaxed);
+}
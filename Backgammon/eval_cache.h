@@ -0,0 +1,75 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include "inttyp.h"
+#include "board.h"
+
+// eval_context holds the shared instance
+/// <summary>
+/// Fixed size cache of evaluations, shared by all threads without locks.
+///
+/// An entry is 16 bytes: the data (the P(win) bits and a valid bit) and the
+/// key xor the data. A bucket is 4 entries, one cache line. Entries are
+/// written and read with two relaxed 64 bit atomics: a torn entry does not
+/// check against its key, so it reads as a miss and is never returned.
+/// A store replaces the entry of the same key, else an empty one, else the
+/// one chosen by the top bits of the key.
+/// </summary>
+struct eval_cache
+{
+	static const size_t default_mb = 32;
+	static const int	ways = 4;
+
+	struct entry
+	{
+		std::atomic<uint64>	check;	// key ^ data
+		std::atomic<uint64>	data;	// valid << 32 | P(win) bits
+	};
+	struct alignas(64) bucket
+	{
+		entry	e[ways];
+	};
+
+	explicit eval_cache(size_t mb = default_mb) { resize(mb); }
+
+	/// <summary>
+	/// Reallocate and clear the cache: not while other threads use it
+	/// </summary>
+	/// <param name="mb">size in megabytes, rounded down to a power of 2 of buckets; 0 disables the cache</param>
+	void	resize(size_t mb);
+	void	clear();
+
+	bool	enabled() const { return n_buckets != 0; }
+	size_t	size() const { return n_buckets * ways; }	// entries
+
+	/// <summary>
+	/// 64 bit key of the board b with side to_move to roll
+	/// </summary>
+	static uint64	key(const Board& b, Color to_move);
+
+	// Start loading the bucket of key, to probe it later
+	void	prefetch(uint64 key) const { _mm_prefetch(reinterpret_cast<const char*>(&find(key)), _MM_HINT_T0); }
+	bool	probe(uint64 key, float& p);
+	void	store(uint64 key, float p);
+
+	// Sums of the counters of all the threads
+	uint64	hits() const;
+	uint64	misses() const;
+	double	hit_rate() const { uint64 n = hits() + misses(); return n ? double(hits()) / n : 0.0; }
+
+private:
+	// Probe counters, a cache line per shard, the threads spread over the shards
+	static const int	shards = 64;
+	struct alignas(64) counters
+	{
+		std::atomic<uint64>	hits{ 0 }, misses{ 0 };
+	};
+
+	std::unique_ptr<bucket[]>	buckets;
+	size_t						n_buckets = 0;
+	counters					count[shards];
+
+	static int	shard();	// of the calling thread
+
+	bucket&	find(uint64 key) const { return buckets[key & (n_buckets - 1)]; }
+};
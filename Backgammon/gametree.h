@@ -10,6 +10,8 @@
 #include "roll.h"
 #include "range.h"
 #include "board.h"
+#include "cube.h"
+#include "nn.h"
 
 // Design notes:
 //
@@ -101,7 +103,23 @@ struct BoardVal
 	Transitions<1>* t;
 };
 
-using Tree = std::map<Board, BoardVal>;
+/// <summary>
+/// A Board and the side to move.
+/// Boards keep a fixed orientation down the tree: moves are generated
+/// in place for the side to move instead of flipping the board each ply.
+/// </summary>
+struct Position
+{
+	Board	board;
+	Color	to_move;
+
+	bool operator< (const Position& p) const
+	{
+		return (to_move != p.to_move) ? to_move < p.to_move : board < p.board;
+	}
+};
+
+using Tree = std::map<Position, BoardVal>;
 using Choice = Tree::iterator;
 using Choices = Rng<Choice>;
 //using State = Rng<Choice>;
@@ -125,7 +143,7 @@ const float c_puct = 1.414f;		// sqrt(2)
 class GameTree
 {
 public:
-	using Tree = std::map<Board, BoardVal>;
+	using Tree = ::Tree;
 	using Choice = Tree::iterator;
 	using State = Rng<Choice>;
 
@@ -139,24 +157,48 @@ private:
 	Tree		tt;
 	Container	data;
 
-	// These three members are manipulated by push_board
+	// These four members are manipulated by push_board
 	// in a stateful, episodic fashion to construct the
 	// Transition array when expanding leaf nodes.
 	Tran		T;
 	int			t_beg;
 	int			s_cnt;
+	Color		to_move;	// side to move in the boards pushed
+
+	// Contact evaluator following the moves generated, or nullptr
+	nn_accumulator*		acc;
+
+	// New boards of the Transition array, evaluated together by end_state
+	std::vector<Choice>	pending;
+	std::vector<Board>	pending_boards;
+	std::vector<float>	pending_q;
+
+	void eval_pending()
+	{
+		pending_q.resize(pending.size());
+		Board::eval(pending_boards.data(), pending_boards.size(), pending_q.data(), to_move);
+		for (size_t i = 0; i < pending.size(); ++i)
+			pending[i]->second.Q = pending_q[i];
+		pending.clear();
+		pending_boards.clear();
+	}
 
 public:
-	GameTree(Container::size_type sz = default_size) : data(), T(0), t_beg(0), s_cnt(21)
+	GameTree(Container::size_type sz = default_size) : data(), T(0), t_beg(0), s_cnt(21), to_move(Black), acc(nullptr)
 	{
 		data.reserve(sz);
 		Assert(sizeof Transitions<1> == sizeof(Transitions<0>) + sizeof(Choice));
 		Assert(sizeof Transitions<0> == tsize * sizeof Choice);
 	}
 
-	Tran push_transition()
+	/// <summary>
+	/// Start the Transition array of a leaf being expanded.
+	/// </summary>
+	/// <param name="next">side to move in the boards which will be pushed</param>
+	Tran push_transition(Color next)
 	{
 		Assert(s_cnt == 21);
+		to_move = next;
 		data.resize(data.size() + tsize);
 
 		T = reinterpret_cast<Tran>(&data[data.size() - tsize]);
@@ -165,31 +207,52 @@ public:
 		T->offset[0] = 0;
 		return T;
 	}
-	void end_state() { Assert(s_cnt < 21); T->offset[++s_cnt] = data.size() - t_beg; }
+	void end_state()
+	{
+		Assert(s_cnt < 21);
+		T->offset[++s_cnt] = data.size() - t_beg;
+		if (s_cnt == 21)
+			eval_pending();
+	}
 
 	void push_choice(Choice c) { data.emplace_back(c); }
+
+	/// <summary>
+	/// Evaluate the contact boards pushed from the accumulator a (nullptr: stop),
+	/// which follows the moves of the generator
+	/// </summary>
+	void follow(nn_accumulator* a) { acc = a; }
+	// MoveContainer interface
+	void moved(Pip from, Pip to)	{ if (acc) acc->moved(from, to); }
+	void unmoved(Pip from, Pip to)	{ if (acc) acc->unmoved(from, to); }
+
 	/// <summary>
 	/// Find/insert board into tree and 
 	/// initialize BoardVal of new boards.
 	/// Push the corresponding choice (tree iterator)
 	/// onto the Choice array of State being constructed.
+	/// The values of the new boards are set by the last end_state
+	/// of the Transition array, in one batch, except for contact boards
+	/// followed by the accumulator: their output layer is evaluated at once.
 	/// </summary>
 	/// <param name="b"></param>
-	void push_board(Board& b)
+	void push_board(const Board& b)
 	{
-		auto cb = tt.try_emplace(b);
+		auto cb = tt.try_emplace(Position{ b, to_move });
 		Choice c = cb.first;
-		if (!cb.second)
+		if (cb.second)
 		{
-			c->second.Q = b.eval();
 			c->second.n = 1;
+			if (acc && !(b.position_class() & Race))
+				c->second.Q = acc->Pwin();
+			else
+			{
+				pending.push_back(c);
+				pending_boards.push_back(b);
+			}
 		}
 		push_choice(c);
 	}
-	void genMoves(Board& b, Info& info, Roll& dice)
-	{
-		return b.genMoves(*this, info, dice.hi, dice.lo);
-	}
 };
 
 
@@ -203,7 +266,8 @@ private:
 public:
 	Node(Choice c) : node(*c) {}
 
-	const Board&	board()			{ return node.first; }
+	const Board&	board()			{ return node.first.board; }
+	Color			to_move()		{ return node.first.to_move; }
 	int&			N()				{ return node.second.n; }
 	float&			Q()				{ return node.second.Q; }
 	bool			leaf()			{ return 0 == node.second.t; }
@@ -256,13 +320,28 @@ struct Player
 	using Tran = GameTree::Tran;
 
 	GameTree&	t;
-	Board&		root;				// Black to play
+	Board&		root;				// Black to play, moves generated in place
+	CubeState	cube;				// seen from Black
 
-	Player(GameTree& tree, Board& board) : t(tree), root(board) {}
+	Player(GameTree& tree, Board& board) : t(tree), root(board), cube(Centered) {}
 
 	void	new_board(Board& board)	{ root = board; }
-	bool	OfferDbl()				{ return false; }
-	bool	AcceptDbl()				{ return true; }
+	void	new_game(Board& board)	{ root = board; cube = Centered; }
+	// Double before rolling root
+	bool	OfferDbl()				{ return offer_double(root, Black, cube); }
+	// White took the double of Black: White owns the cube
+	void	DoubleTaken()			{ cube = Unavailable; }
+	// Take a double of White, offered before rolling root with White to move.
+	// Black owns the cube once it takes.
+	bool	AcceptDbl()
+	{
+		Assert(cube != Owned);
+		// The cube after the take, seen from White
+		if (!accept_double(root, White, flip(Owned)))
+			return false;
+		cube = Owned;
+		return true;
+	}
 
 	Node	BestChoice(State& s, Budget budget)
 	{
@@ -278,13 +357,12 @@ struct Player
 
 	Node	BestChoice(Roll& R, Budget budget)
 	{
-		Tran T = t.push_transition();
+		Tran T = t.push_transition(White);
 		// Fill choice array for each State transition
-		BoardInfo b(root);
 		for (auto& r : Roll::rolls21)
 		{
 			if (r == R)
-				genMoves(t, b, r);
+				genMoves<Black>(t, root, r);
 			t.end_state();
 		}
 		State s((*T)[R.ordinal]);
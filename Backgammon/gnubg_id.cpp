@@ -0,0 +1,328 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include "gnubg_id.h"
+
+namespace {
+
+const char base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Value of each base64 character, -1 for the others
+struct base64_values
+{
+    int8    v[256];
+
+    constexpr base64_values() : v()
+    {
+        for (int i = 0; i < 256; ++i)
+            v[i] = -1;
+        for (int k = 0; k < 64; ++k)
+            v[uint8(base64[k])] = int8(k);
+    }
+};
+constexpr base64_values base64_value;
+
+// Base64 of the n bytes of b, without padding: (8n + 5) / 6 characters
+template<int n>
+void to_base64(const uint8* b, char* s)
+{
+    for (int i = 0; i < n; i += 3, s += 4)
+    {
+        int r = std::min(n - i, 3);
+        uint32 v = uint32(b[i]) << 16 | (r > 1 ? uint32(b[i + 1]) << 8 : 0) | (r > 2 ? uint32(b[i + 2]) : 0);
+        for (int k = 0; k <= r; ++k)
+            s[k] = base64[(v >> (18 - 6 * k)) & 63];
+    }
+}
+
+// The n bytes of the (8n + 5) / 6 base64 characters s
+template<int n>
+bool from_base64(const char* s, uint8* b)
+{
+    for (int i = 0; i < n; i += 3, s += 4)
+    {
+        int r = std::min(n - i, 3);
+        uint32 v = 0;
+        for (int k = 0; k <= r; ++k)
+        {
+            int x = base64_value.v[uint8(s[k])];
+            if (x < 0)
+                return false;
+            v |= uint32(x) << (18 - 6 * k);
+        }
+        // The bits of the last character past the last byte are 0
+        if (v & ((1u << (24 - 8 * r)) - 1))
+            return false;
+        for (int k = 0; k < r; ++k)
+            b[i + k] = uint8(v >> (16 - 8 * k));
+    }
+    return true;
+}
+
+/// <summary>
+/// String of up to 128 bits, the first in the low bit of w[0]: the bytes of
+/// the match ID on a little endian machine
+/// </summary>
+struct bitstring
+{
+    uint64  w[2] = { 0, 0 };
+    int     n = 0;
+
+    // Append the len low bits of v (len <= 32)
+    void    put(uint64 v, int len)
+    {
+        int i = n >> 6, s = n & 63;
+        w[i] |= v << s;
+        if (s + len > 64)
+            w[1] |= v >> (64 - s);
+        n += len;
+    }
+    // The len bits from bit 'at' (len <= 32)
+    uint32  get(int at, int len) const
+    {
+        int i = at >> 6, s = at & 63;
+        uint64 v = w[i] >> s;
+        if (s + len > 64)
+            v |= w[1] << (64 - s);
+        return uint32(v & ((uint64(1) << len) - 1));
+    }
+};
+
+// Bits of two points of a, b checkers (0 .. 15): a 1s, a 0, b 1s, a 0
+struct point_pairs
+{
+    uint32  bits[256];  // of a | b << 4
+    uint8   len[256];
+
+    constexpr point_pairs() : bits(), len()
+    {
+        for (int a = 0; a < 16; ++a)
+            for (int b = 0; b < 16; ++b)
+            {
+                bits[a | b << 4] = ((1u << a) - 1) | ((1u << b) - 1) << (a + 1);
+                len[a | b << 4] = uint8(a + b + 2);
+            }
+    }
+};
+constexpr point_pairs point_pair;
+
+// Bits of side C: its points from its ace point (pip 24), then its bar. At most 40 bits, len of them.
+template<Color C>
+uint64 side_bits(const Board& b, int& len)
+{
+    uint64 x = 0;
+    int n = 0;
+    for (Pip p = 24; p >= 2; p -= 2)
+    {
+        int k = std::max(0, b.pt<C>(p)) | std::max(0, b.pt<C>(p - 1)) << 4;
+        x |= uint64(point_pair.bits[k]) << n;
+        n += point_pair.len[k];
+    }
+    // The bar: a run of 1s and a 0
+    x |= ((uint64(1) << b.bar<C>()) - 1) << n;
+    len = n + b.bar<C>() + 1;
+    return x;
+}
+
+template<Color C>
+void encode(const Board& b, char* s)
+{
+    int len0, len1;
+    uint64 x0 = side_bits<opponent(C)>(b, len0);
+    uint64 x1 = side_bits<C>(b, len1);
+    // len0 is 25 .. 40
+    uint64 w[2] = { x0 | x1 << len0, x1 >> (64 - len0) };
+    uint8 bytes[10];
+    std::memcpy(bytes, w, sizeof bytes);
+    to_base64<sizeof bytes>(bytes, s);
+}
+
+// Points of side C from the counts n of its 24 points from the ace point, then its bar
+template<Color C>
+void set_side(Board& b, const int* n)
+{
+    int on_board = 0, pips = 0;
+    for (int j = 0; j < 24; ++j)
+    {
+        b.add<C>(24 - j, n[j]);
+        on_board += n[j];
+        pips += (j + 1) * n[j];
+    }
+    b.add<C>(w_bar, n[24]);
+    b.add<C>(25, 15 - on_board - n[24]);
+    b.pipCnt<C>() = int16(pips + 25 * n[24]);
+}
+
+template<Color C>
+bool decode(const char* s, Board& b)
+{
+    uint8 bytes[16] = {};
+    if (!from_base64<10>(s, bytes))
+        return false;
+    uint64 w[2];
+    std::memcpy(w, bytes, sizeof w);
+
+    // Each zero ends a point: the count is the 1s since the previous zero.
+    // 50 zeros in 80 bits, the side not on roll first.
+    int n[2][25];
+    uint64 z = ~w[0];
+    int prev = -1, base = 0;
+    for (int side = 0; side < 2; ++side)
+    {
+        int total = 0;
+        for (int j = 0; j < 25; ++j)
+        {
+            if (z == 0)
+            {
+                if (base != 0)
+                    return false;
+                base = 64;
+                z = ~w[1];
+            }
+            int at = base + int(_tzcnt_u64(z));
+            z = _blsr_u64(z);
+            total += n[side][j] = at - prev - 1;
+            prev = at;
+        }
+        if (total > 15)
+            return false;
+    }
+    // Only zeros after the 50th zero, within the 80 bits
+    if (prev >= 80 || (prev < 64 ? (w[0] >> prev >> 1 | w[1]) : (w[1] >> (prev - 64) >> 1)) != 0)
+        return false;
+    // A point is the ace point of one side and the 24 point of the other
+    for (int j = 0; j < 24; ++j)
+        if (n[1][j] && n[0][23 - j])
+            return false;
+
+    b.board.fill(0);
+    b._barB = 0;
+    b._finishedB = 0;
+    set_side<opponent(C)>(b, n[0]);
+    set_side<C>(b, n[1]);
+    return true;
+}
+
+// Match ID fields: offset and width in bits
+enum match_field
+{
+    f_cube = 0, f_owner = 4, f_on_roll = 6, f_crawford = 7, f_state = 8, f_turn = 11, f_doubled = 12,
+    f_resign = 13, f_die1 = 15, f_die2 = 18, f_length = 21, f_score0 = 36, f_score1 = 51, match_bits = 66
+};
+const int score_bits = 15;
+
+}
+
+void encode_position_id(const Board& b, Color to_move, char* s)
+{
+    if (to_move == White)
+        encode<White>(b, s);
+    else
+        encode<Black>(b, s);
+}
+
+std::string encode_position_id(const Board& b, Color to_move)
+{
+    char s[position_id_size];
+    encode_position_id(b, to_move, s);
+    return std::string(s, sizeof s);
+}
+
+bool decode_position_id(const char* s, Board& b, Color to_move)
+{
+    return (to_move == White) ? decode<White>(s, b) : decode<Black>(s, b);
+}
+
+bool decode_position_id(const std::string& s, Board& b, Color to_move)
+{
+    return s.size() == position_id_size && decode_position_id(s.data(), b, to_move);
+}
+
+void match_id::encode(char* s) const
+{
+    int log_cube = 0;
+    while ((2 << log_cube) <= cube)
+        ++log_cube;
+    bitstring x;
+    x.put(log_cube, 4);
+    x.put(owner < 0 ? 3 : owner, 2);
+    x.put(on_roll, 1);
+    x.put(crawford, 1);
+    x.put(state, 3);
+    x.put(turn, 1);
+    x.put(doubled, 1);
+    x.put(resign, 2);
+    x.put(dice[0], 3);
+    x.put(dice[1], 3);
+    x.put(length, score_bits);
+    x.put(score[0], score_bits);
+    x.put(score[1], score_bits);
+    uint8 bytes[16];
+    std::memcpy(bytes, x.w, sizeof bytes);
+    to_base64<9>(bytes, s);
+}
+
+std::string match_id::encode() const
+{
+    char s[match_id_size];
+    encode(s);
+    return std::string(s, sizeof s);
+}
+
+bool match_id::decode(const char* s)
+{
+    uint8 bytes[16] = {};
+    if (!from_base64<9>(s, bytes))
+        return false;
+    bitstring x;
+    std::memcpy(x.w, bytes, sizeof bytes);
+    if (x.get(match_bits, 64 - match_bits % 64) != 0)
+        return false;
+
+    int own = x.get(f_owner, 2);
+    cube = 1 << x.get(f_cube, 4);
+    owner = (own == 3) ? -1 : own;
+    on_roll = Color(x.get(f_on_roll, 1));
+    crawford = x.get(f_crawford, 1) != 0;
+    state = x.get(f_state, 3);
+    turn = Color(x.get(f_turn, 1));
+    doubled = x.get(f_doubled, 1) != 0;
+    resign = x.get(f_resign, 2);
+    dice[0] = x.get(f_die1, 3);
+    dice[1] = x.get(f_die2, 3);
+    length = x.get(f_length, score_bits);
+    score[0] = x.get(f_score0, score_bits);
+    score[1] = x.get(f_score1, score_bits);
+    return own != 2 && state <= dropped && dice[0] <= 6 && dice[1] <= 6;
+}
+
+bool match_id::decode(const std::string& s)
+{
+    return s.size() == match_id_size && decode(s.data());
+}
+
+id_benchmark benchmark_position_ids(const std::vector<std::pair<Board, Color>>& boards)
+{
+    using clock = std::chrono::steady_clock;
+    id_benchmark r;
+    r.n = boards.size();
+    if (r.n == 0)
+        return r;
+
+    std::vector<char> ids(r.n * position_id_size);
+    std::vector<Board> decoded(r.n);
+    std::vector<char> ok(r.n);
+    auto t0 = clock::now();
+    for (size_t k = 0; k < r.n; ++k)
+        encode_position_id(boards[k].first, boards[k].second, &ids[k * position_id_size]);
+    auto t1 = clock::now();
+    for (size_t k = 0; k < r.n; ++k)
+        ok[k] = decode_position_id(&ids[k * position_id_size], decoded[k], boards[k].second);
+    auto t2 = clock::now();
+    r.ns_encode = std::chrono::duration<double, std::nano>(t1 - t0).count() / r.n;
+    r.ns_decode = std::chrono::duration<double, std::nano>(t2 - t1).count() / r.n;
+
+    for (size_t k = 0; k < r.n; ++k)
+        r.errors += !(ok[k] && decoded[k] == boards[k].first);
+    return r;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+#include "board.h"
+#include "cube.h"
+#include "inttyp.h"
+
+// Position and match IDs in the base64 text format of GNU Backgammon, read and written by most analysis tools.
+// Player 0 of these IDs is White, player 1 Black.
+
+constexpr int position_id_size = 14;	// characters
+constexpr int match_id_size = 12;
+
+/// <summary>
+/// Position ID of b: for the side not on roll, then for the side on roll, the
+/// checkers on each of its points from its ace point to its 24 point, then on
+/// its bar, each point as that many 1 bits and a 0 bit. The 80 bits, the first
+/// in the low bit of the first byte, are 10 bytes in 14 base64 characters.
+/// Borne off checkers are not written: they are the rest of the 15.
+/// </summary>
+/// <param name="s">the 14 characters, not null terminated</param>
+void		encode_position_id(const Board& b, Color to_move, char* s);
+std::string	encode_position_id(const Board& b, Color to_move);
+/// <summary>
+/// The board of the position ID s, to_move on roll (which the ID does not tell)
+/// </summary>
+/// <param name="s">14 characters</param>
+/// <returns>false if s is not the ID of a position (b is then unspecified)</returns>
+bool		decode_position_id(const char* s, Board& b, Color to_move);
+bool		decode_position_id(const std::string& s, Board& b, Color to_move);
+
+/// <summary>
+/// Match ID: the cube, the turn, the dice and the score, in 66 bits: 9 bytes in
+/// 12 base64 characters
+/// </summary>
+struct match_id
+{
+	enum game_state { no_game, playing, over, resigned, dropped };
+
+	int		cube = 1;				// value of the cube, a power of 2
+	int		owner = -1;				// Color of the cube owner, -1 centered
+	Color	on_roll = Black;
+	bool	crawford = false;		// this game is the Crawford game
+	int		state = playing;		// game_state
+	Color	turn = Black;			// side to act: on_roll, or its opponent to take a double
+	bool	doubled = false;		// a double is offered
+	int		resign = 0;				// points of the resignation offered, 0 if none
+	int		dice[2] = { 0, 0 };		// 0 before the roll
+	int		length = 0;				// points of the match, 0 for money
+	int		score[2] = { 0, 0 };	// points of White, of Black
+
+	CubeState	cube_state() const { return owner < 0 ? Centered : owner == on_roll ? Owned : Unavailable; }
+
+	/// <param name="s">the 12 characters, not null terminated</param>
+	void		encode(char* s) const;
+	std::string	encode() const;
+	/// <param name="s">12 characters</param>
+	/// <returns>false if s is not a match ID (*this is then unspecified)</returns>
+	bool		decode(const char* s);
+	bool		decode(const std::string& s);
+};
+
+/// <summary>
+/// Time of the position IDs of the boards, encoded then decoded back
+/// </summary>
+struct id_benchmark
+{
+	size_t	n = 0;				// boards
+	size_t	errors = 0;			// boards not decoded to themselves
+	double	ns_encode = 0.0;	// per board
+	double	ns_decode = 0.0;
+};
+id_benchmark	benchmark_position_ids(const std::vector<std::pair<Board, Color>>& boards);
@@ -1,10 +1,19 @@
 
+#include <cmath>
 #include <iostream>
+#include <string>
 #include <vector>
 #include <list>
 #include <stdlib.h>
 #include <algorithm>
 #include "eval.h"
+#include "nn.h"
+#include "train.h"
+#include "rollout.h"
+#include "analyze.h"
+#include "dataset.h"
+#include "gnubg_id.h"
+#include "scm.h"
 // #include "endgame.h"
 
 #include "board.h"
@@ -15,12 +24,257 @@ int usage(char** argv)
 
     std::cerr << "usage: " << std::endl
         << argv[0] << "<start> <n>" << std::endl
-        << argv[0] << " <pip1> <pip2> ... <pip6>" << std::endl;
+        << argv[0] << " <pip1> <pip2> ... <pip6>" << std::endl
+        << argv[0] << " train <games> [threads] [log dataset]" << std::endl
+        << argv[0] << " fit <dataset> [epochs] [threads]" << std::endl
+        << argv[0] << " rollout <games> [threads]" << std::endl
+        << argv[0] << " rollout-check [games]" << std::endl
+        << argv[0] << " bearoff-db [path]" << std::endl
+        << argv[0] << " calibrate [games]" << std::endl
+        << argv[0] << " bench-ids [games]" << std::endl
+        << argv[0] << " analyze [-threads n] [-games n] [-ordered] [-csv] [-dataset file] [-write dataset] < positions" << std::endl;
     return -1;
 }
 
+// Self-play training of the contact net, from contact.nn if there is one
+int train(int argc, char** argv)
+{
+    nn_eval net;
+    if (!net.load(nn_eval::default_path))
+        net.init(128, 1);
+    td_trainer::options opt;
+    if (argc > 3)
+        opt.threads = atoi(argv[3]);
+    if (argc > 4)
+        opt.log = argv[4];
+    td_trainer trainer(net, opt);
+    bool saved = trainer.run(strtoull(argv[2], nullptr, 10), [](const td_trainer::stats& s) {
+        std::cout << s.games << " games, " << s.positions << " positions, "
+            << s.games_per_sec() << " games/s" << std::endl;
+    });
+    if (!saved)
+        std::cerr << "can not save " << opt.path << (opt.log.empty() ? "" : " or " + opt.log) << std::endl;
+    return saved ? 0 : -1;
+}
+
+// Supervised training of the contact net on the results of a dataset
+int fit(int argc, char** argv)
+{
+    dataset_reader data;
+    if (!data.open(argv[2]))
+    {
+        std::cerr << "can not read " << argv[2] << std::endl;
+        return -1;
+    }
+    nn_eval net;
+    if (!net.load(nn_eval::default_path))
+        net.init(128, 1);
+    td_trainer::options opt;
+    if (argc > 4)
+        opt.threads = atoi(argv[4]);
+    td_trainer trainer(net, opt);
+    bool saved = trainer.fit(data, argc > 3 ? atoi(argv[3]) : 1, [](const td_trainer::stats& s) {
+        std::cout << "epoch " << s.games << ", " << s.positions << " positions, "
+            << (s.seconds > 0 ? s.positions / s.seconds : 0.0) << " positions/s" << std::endl;
+    });
+    if (!saved)
+        std::cerr << "can not save " << opt.path << std::endl;
+    return saved ? 0 : -1;
+}
+
+// Rollout of the starting position, Black to roll
+int rollout(int argc, char** argv)
+{
+    rollout_options opt;
+    if (argc > 3)
+        opt.threads = atoi(argv[3]);
+    rollout_result r = rollout(Board(), Black, strtoull(argv[2], nullptr, 10), opt);
+    std::cout << r.games << " games, " << r.seconds << " s" << std::endl
+        << "P(win):  " << r.pwin.mean << " +- " << r.pwin.std_error
+        << " (" << r.pwin_raw.mean << " +- " << r.pwin_raw.std_error << " not luck adjusted)" << std::endl
+        << "equity:  " << r.equity.mean << " +- " << r.equity.std_error << std::endl;
+    return 0;
+}
+
+// Build the bearoff database and write it
+int bearoff_build(int argc, char** argv)
+{
+    std::string path = argc > 2 ? argv[2] : bearoff_db::default_path;
+    bearoff_db db;
+    db.build();
+    if (!db.save(path))
+    {
+        std::cerr << "can not write " << path << std::endl;
+        return -1;
+    }
+    std::cout << "wrote " << path << std::endl;
+    return 0;
+}
+
+// Truncated rollout against played out games, from a race which enters the
+// p_exact region with the opponent on roll: Black to roll, 8 checkers left, White 7
+int rollout_check(int argc, char** argv)
+{
+    Board b;
+    b.board.fill(0);
+    b.board[21] = 1;
+    b.board[22] = b.board[23] = b.board[24] = 2;
+    b.board[25] = 8;
+    b.board[1] = b.board[2] = b.board[3] = b.board[4] = -2;
+    b._barB = 0;
+    b._finishedB = 7;
+    b.ComputePipCount();
+
+    uint64 n = argc > 2 ? strtoull(argv[2], nullptr, 10) : 40000;
+    rollout_options opt;
+    opt.truncate = false;
+    rollout_result full = rollout(b, Black, n, opt);
+    opt.truncate = true;
+    rollout_result cut = rollout(b, Black, n, opt);
+    // The results of the games: not luck adjusted, which is exact on races and would hide the error
+    double diff = cut.pwin_raw.mean - full.pwin_raw.mean;
+    double se = std::sqrt(cut.pwin_raw.std_error * cut.pwin_raw.std_error + full.pwin_raw.std_error * full.pwin_raw.std_error);
+    bool ok = std::abs(diff) <= 4 * se + 1e-6;
+    std::cout << "P(win) played out: " << full.pwin_raw.mean << " +- " << full.pwin_raw.std_error << std::endl
+        << "P(win) truncated:  " << cut.pwin_raw.mean << " +- " << cut.pwin_raw.std_error << std::endl
+        << (ok ? "agree" : "DIFFER") << ", difference " << diff << std::endl;
+    return ok ? 0 : 1;
+}
+
+// Int8 contact net against the float net, on the contact positions of random games
+int calibrate_int8(int argc, char** argv)
+{
+    nn_eval net_float, net_int8;
+    if (!net_float.load(nn_eval::default_path) || !net_int8.load(nn_eval::default_path, nn_eval::Int8))
+    {
+        std::cerr << "can not read " << nn_eval::default_path << std::endl;
+        return -1;
+    }
+    struct Successors {
+        std::vector<Board> v;
+        void push_board(const Board& b) { v.push_back(b); }
+    };
+    int games = argc > 2 ? atoi(argv[2]) : 1000;
+    std::vector<std::pair<Board, Color>> boards;
+    for (int game = 0; game < games; ++game)
+    {
+        Board b;
+        for (Color c = Black; b.position_class() == Contact; c = opponent(c))
+        {
+            boards.emplace_back(b, c);
+            Successors s;
+            genMoves(s, b, roll_dice(), c);
+            if (s.v.empty())
+                break;
+            b = s.v[rand() % s.v.size()];
+        }
+    }
+    nn_calibration r = calibrate(net_float, net_int8, boards);
+    std::cout << "CONTACT NET int8 - float, " << r.n << " positions" << std::endl
+        << "|P(win)| mean, max: " << r.mean_pwin << ", " << r.max_pwin << std::endl
+        << "max |output|:       " << r.max_output << std::endl
+        << "ns per board:       " << r.ns_float << " float, " << r.ns_int8 << " int8" << std::endl;
+    return 0;
+}
+
+// Position IDs of the positions of random games, encoded and decoded back
+int bench_ids(int argc, char** argv)
+{
+    struct Successors {
+        std::vector<Board> v;
+        void push_board(const Board& b) { v.push_back(b); }
+    };
+    int games = argc > 2 ? atoi(argv[2]) : 10000;
+    std::vector<std::pair<Board, Color>> boards;
+    for (int game = 0; game < games; ++game)
+    {
+        Board b;
+        for (Color c = Black; b.finishedW() < 15 && b.finishedB() < 15; c = opponent(c))
+        {
+            boards.emplace_back(b, c);
+            Successors s;
+            genMoves(s, b, roll_dice(), c);
+            if (!s.v.empty())
+                b = s.v[rand() % s.v.size()];
+        }
+    }
+    id_benchmark r = benchmark_position_ids(boards);
+    std::cout << "POSITION ID " << encode_position_id(Board(), Black) << ", " << r.n << " positions" << std::endl
+        << "errors:            " << r.errors << std::endl
+        << "ns per position:   " << r.ns_encode << " encode, " << r.ns_decode << " decode" << std::endl;
+    return r.errors ? 1 : 0;
+}
+
+// Filter of position IDs on stdin to results on stdout
+int analyze(int argc, char** argv)
+{
+    // Build the tables while the options, the dataset and the input are read
+    evaluation.warm_up();
+    analysis_options opt;
+    dataset_reader data;
+    dataset_writer results;
+    std::string input;
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string a = argv[i];
+        if (a == "-threads" && i + 1 < argc)
+            opt.threads = atoi(argv[++i]);
+        else if (a == "-games" && i + 1 < argc)
+            opt.games = strtoull(argv[++i], nullptr, 10);
+        else if (a == "-ordered")
+            opt.ordered = true;
+        else if (a == "-csv")
+            opt.csv = true;
+        else if (a == "-dataset" && i + 1 < argc)
+            input = argv[++i];
+        else if (a == "-write" && i + 1 < argc)
+        {
+            if (!results.open(argv[++i], true))
+            {
+                std::cerr << "can not write " << argv[i] << std::endl;
+                return -1;
+            }
+            opt.results = &results;
+        }
+        else
+            return usage(argv);
+    }
+    if (!input.empty() && !data.open(input))
+    {
+        std::cerr << "can not read " << input << std::endl;
+        return -1;
+    }
+    std::ios::sync_with_stdio(false);
+    uint64 errors = input.empty() ? analyze(std::cin, std::cout, opt) : analyze(data, std::cout, opt);
+    if (!results.close())
+    {
+        std::cerr << "can not write the results" << std::endl;
+        return -1;
+    }
+    return errors ? 1 : 0;
+}
+
 int main(int argc, char** argv)
 {
+    if (argc >= 3 && std::string(argv[1]) == "train")
+        return train(argc, argv);
+    if (argc >= 3 && std::string(argv[1]) == "fit")
+        return fit(argc, argv);
+    if (argc >= 2 && std::string(argv[1]) == "bearoff-db")
+        return bearoff_build(argc, argv);
+    if (argc >= 2 && std::string(argv[1]) == "rollout-check")
+        return rollout_check(argc, argv);
+    if (argc >= 3 && std::string(argv[1]) == "rollout")
+        return rollout(argc, argv);
+    if (argc >= 2 && std::string(argv[1]) == "analyze")
+        return analyze(argc, argv);
+    if (argc >= 2 && std::string(argv[1]) == "calibrate")
+        return calibrate_int8(argc, argv);
+    if (argc >= 2 && std::string(argv[1]) == "bench-ids")
+        return bench_ids(argc, argv);
+
+    PNR& Pnr = evaluation.pnr();
+    p_exact& exact = evaluation.exact();
     int cnt = 0;
     const int nx = 8;
     std::cout << std::endl << "DBG exact.Pwin(i, j)";
@@ -49,6 +303,43 @@ int main(int argc, char** argv)
     std::cout << std::endl << "MAX DIFF (Pnr.PWIN - x.PWIN)@ (" << I << ", " << J << ") : " << max_diff << std::endl;
     std::cout << Board(I, J);
 
+    // Race evaluator against the exact win probabilities:
+    // Single Checker Model of the raw and of the effective pip counts
+    std::vector<float> pips(p_exact::N), epc(p_exact::N);
+    for (int i = 0; i < p_exact::N; ++i)
+    {
+        eg_hash::inner_table t;
+        eg.inverse_hash(i, t);
+        pips[i] = 0;
+        for (int p = 1; p < 7; ++p)
+            pips[i] += p * t[p];
+        epc[i] = pips_per_roll * Pnr[i];
+    }
+    double sum_pips = 0.0, sum_epc = 0.0, max_pips = 0.0, max_epc = 0.0;
+    for (int i = 1; i < p_exact::N; ++i)
+        for (int j = 1; j < p_exact::N; ++j)
+        {
+            double d_pips = std::abs(ScmPwin(ScmStat(pips[i], pips[j])) - exact.Pwin(i, j));
+            double d_epc = std::abs(ScmPwin(ScmStat(epc[i], epc[j])) - exact.Pwin(i, j));
+            sum_pips += d_pips; max_pips = std::max(max_pips, d_pips);
+            sum_epc += d_epc; max_epc = std::max(max_epc, d_epc);
+        }
+    const double n_pairs = double(p_exact::N - 1) * (p_exact::N - 1);
+    std::cout << std::endl << "RACE EVAL |SCM - x.PWIN| mean, max" << std::endl
+        << "pips:           " << sum_pips / n_pairs << ", " << max_pips << std::endl
+        << "effective pips: " << sum_epc / n_pairs << ", " << max_epc << std::endl;
+
+    // Large pip gaps: the statistic runs past the SCM table, P(win) must stay in [0, 1]
+    int bad = 0;
+    for (int x = 1; x <= 200; ++x)
+        for (int y = 1; y <= 200; ++y)
+        {
+            float p = ScmPwin(ScmStat(float(x), float(y)));
+            bad += (p < 0.0f || p > 1.0f);
+        }
+    std::cout << "SCM pips 1..200, P(win) out of [0, 1]: " << bad
+        << " (40 vs 100: " << ScmPwin(ScmStat(40.0f, 100.0f)) << ", 5 vs 20: " << ScmPwin(ScmStat(5.0f, 20.0f)) << ")" << std::endl;
+
     switch (argc)
     {
     case 4:
@@ -1,4 +1,6 @@
+#include <memory>
 #include "gametree.h"
+#include "eval.h"
 
 
 int State::N()
@@ -62,15 +64,25 @@ ValueQ Node::expand(GameTree& t)
 { 
 	// Initialize transition ptr
 	Assert(T() == nullptr);
-	T() = t.push_transition();
+	T() = t.push_transition(opponent(to_move()));
 
 	// Fill choice array for each State transition
-	BoardInfo b(board());
+	// generating the moves of the side to move in place
+	Board b(board());
+
+	// Contact successors are evaluated from the accumulator of b
+	std::unique_ptr<nn_accumulator> acc;
+	const nn_eval* net = evaluation.ready() ? evaluation.net() : nullptr;
+	if (net && !(b.position_class() & Race))
+		acc.reset(new nn_accumulator(*net, b, to_move()));
+	t.follow(acc.get());
+
 	for (auto& r : Roll::rolls21)
 	{
-		genMoves(t, b, r);
+		genMoves(t, b, r, to_move());
 		t.end_state();
 	}
+	t.follow(nullptr);
 	// Update N and Q from the values ot the expanded nodes
 	N() = 36;	// Should test whether this value is optimal
 	return Q() = expectedValue(); 
@@ -0,0 +1,545 @@
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include "nn.h"
+
+namespace {
+
+// exp(x) of 8 floats: 2^n * exp(r), |r| <= ln2/2, Cephes polynomial
+inline __m256 exp256(__m256 x)
+{
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-87.0f)), _mm256_set1_ps(87.0f));
+    __m256 n = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(1.44269504f)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256 r = _mm256_fnmadd_ps(n, _mm256_set1_ps(0.693359375f), x);
+    r = _mm256_fnmadd_ps(n, _mm256_set1_ps(-2.12194440e-4f), r);
+
+    __m256 p = _mm256_set1_ps(1.9875691500e-4f);
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.3981999507e-3f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(8.3334519073e-3f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(4.1665795894e-2f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.6666665459e-1f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(5.0000001201e-1f));
+    p = _mm256_fmadd_ps(p, _mm256_mul_ps(r, r), _mm256_add_ps(r, _mm256_set1_ps(1.0f)));
+
+    __m256i e = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+    return _mm256_mul_ps(p, _mm256_castsi256_ps(e));
+}
+
+// 1 / (1 + exp(-x))
+inline __m256 sigmoid256(__m256 x)
+{
+    __m256 one = _mm256_set1_ps(1.0f);
+    return _mm256_div_ps(one, _mm256_add_ps(one, exp256(_mm256_sub_ps(_mm256_setzero_ps(), x))));
+}
+
+// Sum of the 8 floats
+inline float sum256(__m256 x)
+{
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(x), _mm256_extractf128_ps(x, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+}
+
+// a + the sums of the products of the int16 pairs of x and w (vpdpwssd with AVX-VNNI)
+inline __m256i dpwssd(__m256i a, __m256i x, __m256i w)
+{
+#ifdef __AVXVNNI__
+    return _mm256_dpwssd_avx_epi32(a, x, w);
+#else
+    return _mm256_add_epi32(a, _mm256_madd_epi16(x, w));
+#endif
+}
+
+// Sum of the 8 int32
+inline int32 sum256(__m256i x)
+{
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(s);
+}
+
+// Quantize the n weights w[k * ws] to the int8 q[k * qs]
+// returns the scale: q = w * scale
+float quantize_weights(const float* w, size_t ws, int8* q, size_t qs, int n)
+{
+    float m = 0.0f;
+    for (int k = 0; k < n; ++k)
+        m = std::max(m, std::abs(w[k * ws]));
+    float scale = m > 0.0f ? 127.0f / m : 1.0f;
+    for (int k = 0; k < n; ++k)
+        q[k * qs] = int8(std::lround(std::min(127.0f, std::max(-127.0f, w[k * ws] * scale))));
+    return scale;
+}
+
+// 4 units of n checkers on a pip
+inline void encode_pip(float* x, int n)
+{
+    x[0] = n >= 1;
+    x[1] = n >= 2;
+    x[2] = n >= 3;
+    x[3] = n > 3 ? (n - 3) / 2.0f : 0.0f;
+}
+
+template<Color C>
+void encode(const Board& b, float* x)
+{
+    constexpr Color O = opponent(C);
+    for (Pip p = 1; p <= 24; ++p)
+    {
+        encode_pip(x + 4 * (p - 1), std::max(0, b.pt<C>(p)));
+        encode_pip(x + 96 + 4 * (p - 1), std::max(0, b.pt<O>(p)));
+    }
+    x[192] = b.bar<C>() / 2.0f;
+    x[193] = b.bar<O>() / 2.0f;
+    x[194] = b.finished<C>() / 15.0f;
+    x[195] = b.finished<O>() / 15.0f;
+    x[196] = x[197] = x[198] = x[199] = 0.0f;
+}
+
+}
+
+void nn_eval::encode(const Board& b, Color to_move, float* x)
+{
+    if (to_move == White)
+        ::encode<White>(b, x);
+    else
+        ::encode<Black>(b, x);
+}
+
+void nn_eval::init(int n, uint32 seed)
+{
+    Assert(n % 8 == 0 && n <= max_hidden);
+    n_hidden = n;
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> w(-0.1f, 0.1f);
+    W1.resize(size_t(n_inputs) * n_hidden);
+    W2.resize(size_t(n_outputs) * n_hidden);
+    for (auto& v : W1)
+        v = w(rng);
+    for (auto& v : W2)
+        v = w(rng);
+    b1.assign(n_hidden, 0.0f);
+    b2.assign(n_outputs, 0.0f);
+}
+
+bool nn_eval::load(const std::string& path, Precision p)
+{
+    std::ifstream in(path, std::ios::binary);
+    header hd;
+    if (!in.read(reinterpret_cast<char*>(&hd), sizeof hd)
+        || std::memcmp(hd.magic, "BGNNET01", 8) != 0 || hd.version != version
+        || hd.n_inputs != n_inputs || hd.n_outputs != n_outputs
+        || hd.n_hidden == 0 || hd.n_hidden % 8 != 0 || hd.n_hidden > max_hidden)
+        return false;
+
+    n_hidden = int(hd.n_hidden);
+    W1.resize(size_t(n_inputs) * n_hidden);
+    b1.resize(n_hidden);
+    W2.resize(size_t(n_outputs) * n_hidden);
+    b2.resize(n_outputs);
+    for (auto* v : { &W1, &b1, &W2, &b2 })
+        in.read(reinterpret_cast<char*>(v->data()), v->size() * sizeof(float));
+    if (!in)
+    {
+        n_hidden = 0;
+        return false;
+    }
+    precision = Float;
+    if (p == Int8)
+        quantize();
+    return true;
+}
+
+bool nn_eval::save(const std::string& path) const
+{
+    Assert(precision == Float);
+    std::ofstream out(path, std::ios::binary);
+    header hd;
+    std::memcpy(hd.magic, "BGNNET01", 8);
+    hd.version = version;
+    hd.n_inputs = n_inputs;
+    hd.n_hidden = n_hidden;
+    hd.n_outputs = n_outputs;
+    out.write(reinterpret_cast<const char*>(&hd), sizeof hd);
+    for (auto* v : { &W1, &b1, &W2, &b2 })
+        out.write(reinterpret_cast<const char*>(v->data()), v->size() * sizeof(float));
+    return bool(out);
+}
+
+void nn_eval::quantize()
+{
+    Assert(precision == Float && n_hidden > 0);
+    n_q = (n_hidden + 31) / 32 * 32;
+
+    // One scale per hidden unit (a column of W1) and per output (a row of W2)
+    Q1.assign(size_t(n_inputs) * n_q, 0);
+    d1.resize(n_hidden);
+    for (int j = 0; j < n_hidden; ++j)
+        d1[j] = 1.0f / (x_scale * quantize_weights(&W1[j], n_hidden, &Q1[j], n_q, n_inputs));
+    Q2.assign(size_t(n_outputs) * n_q, 0);
+    d2.resize(n_outputs);
+    for (int o = 0; o < n_outputs; ++o)
+        d2[o] = 1.0f / (h_scale * quantize_weights(&W2[size_t(o) * n_hidden], 1, &Q2[size_t(o) * n_q], 1, n_hidden));
+
+    std::vector<float>().swap(W1);
+    std::vector<float>().swap(W2);
+    precision = Int8;
+}
+
+void nn_eval::accumulate(const float* x, float* acc) const
+{
+    if (precision == Int8)
+        return accumulate_q(x, acc);
+    // acc = b1 + sum of x[i] * W1[i]: most inputs are 0, only the others are visited
+    int nz[n_inputs], m = 0;
+    for (int i = 0; i < n_inputs; i += 8)
+    {
+        uint32 mask = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(x + i), _mm256_setzero_ps(), _CMP_NEQ_UQ));
+        for (; mask; mask &= mask - 1)
+            nz[m++] = i + BSF(mask);
+    }
+    // 32 hidden units at a time, accumulated in registers
+    for (int j = 0; j < n_hidden; j += 32)
+    {
+        int k = std::min(4, (n_hidden - j) / 8);
+        __m256 a[4];
+        for (int u = 0; u < k; ++u)
+            a[u] = _mm256_loadu_ps(&b1[j + 8 * u]);
+        for (int q = 0; q < m; ++q)
+        {
+            __m256 xi = _mm256_set1_ps(x[nz[q]]);
+            const float* w = &W1[size_t(nz[q]) * n_hidden + j];
+            for (int u = 0; u < k; ++u)
+                a[u] = _mm256_fmadd_ps(xi, _mm256_loadu_ps(w + 8 * u), a[u]);
+        }
+        for (int u = 0; u < k; ++u)
+            _mm256_storeu_ps(acc + j + 8 * u, a[u]);
+    }
+}
+
+void nn_eval::add_input(float* acc, int i, float dx) const
+{
+    if (precision == Int8)
+        return add_input_q(acc, i, dx);
+    __m256 d = _mm256_set1_ps(dx);
+    const float* w = &W1[size_t(i) * n_hidden];
+    for (int j = 0; j < n_hidden; j += 8)
+        _mm256_storeu_ps(acc + j, _mm256_fmadd_ps(d, _mm256_loadu_ps(w + j), _mm256_loadu_ps(acc + j)));
+}
+
+void nn_eval::output(const float* acc, float* out) const
+{
+    if (precision == Int8)
+        return output_q(acc, out);
+    // The outputs: dot products of the hidden units and the rows of W2
+    __m256 y[n_outputs];
+    for (int o = 0; o < n_outputs; ++o)
+        y[o] = _mm256_setzero_ps();
+    for (int j = 0; j < n_hidden; j += 8)
+    {
+        __m256 h = sigmoid256(_mm256_loadu_ps(acc + j));
+        for (int o = 0; o < n_outputs; ++o)
+            y[o] = _mm256_fmadd_ps(h, _mm256_loadu_ps(&W2[size_t(o) * n_hidden + j]), y[o]);
+    }
+    for (int o = 0; o < n_outputs; ++o)
+        out[o] = 1.0f / (1.0f + std::exp(-(sum256(y[o]) + b2[o])));
+}
+
+void nn_eval::forward(const float* X, size_t n, float* out) const
+{
+    Assert(n_hidden > 0);
+    alignas(32) float acc[max_hidden];
+    for (size_t k = 0; k < n; ++k, X += n_inputs, out += n_outputs)
+    {
+        accumulate(X, acc);
+        output(acc, out);
+    }
+}
+
+void nn_eval::accumulate_q(const float* x, float* acc) const
+{
+    // The non-zero inputs: most are 1, their rows are only added (int16);
+    // the others, as int16, go in pairs to madd (int32), the last one with a 0 input if odd
+    int ones[n_inputs], n1 = 0;
+    int nz[n_inputs + 1], m = 0;
+    int16 xq[n_inputs + 1];
+    for (int i = 0; i < n_inputs; i += 8)
+    {
+        uint32 mask = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(x + i), _mm256_setzero_ps(), _CMP_NEQ_UQ));
+        for (; mask; mask &= mask - 1)
+        {
+            int k = i + BSF(mask);
+            if (x[k] == 1.0f)
+                ones[n1++] = k;
+            else
+            {
+                nz[m] = k;
+                xq[m++] = int16(std::lround(x[k] * x_scale));
+            }
+        }
+    }
+    if (m & 1)
+    {
+        nz[m] = nz[m - 1];
+        xq[m++] = 0;
+    }
+
+    // 32 hidden units at a time
+    const __m256i xs = _mm256_set1_epi32(x_scale);
+    for (int j = 0; j < n_q; j += 32)
+    {
+        // At most 30 inputs are 1 (one per checker): the int16 sums can not overflow
+        __m256i s1[2] = { _mm256_setzero_si256(), _mm256_setzero_si256() };
+        for (int q = 0; q < n1; ++q)
+        {
+            const int8* w = &Q1[size_t(ones[q]) * n_q + j];
+            for (int u = 0; u < 2; ++u)
+                s1[u] = _mm256_add_epi16(s1[u], _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(w + 16 * u))));
+        }
+        // Each pair of other inputs is one madd of their interleaved rows
+        __m256i a[4] = { _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256() };
+        for (int q = 0; q < m; q += 2)
+        {
+            __m256i xx = _mm256_set1_epi32(int32(uint16(xq[q]) | uint32(uint16(xq[q + 1])) << 16));
+            const int8* w0 = &Q1[size_t(nz[q]) * n_q + j];
+            const int8* w1 = &Q1[size_t(nz[q + 1]) * n_q + j];
+            for (int u = 0; u < 2; ++u)
+            {
+                __m256i r0 = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(w0 + 16 * u)));
+                __m256i r1 = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(w1 + 16 * u)));
+                a[2 * u] = dpwssd(a[2 * u], xx, _mm256_unpacklo_epi16(r0, r1));
+                a[2 * u + 1] = dpwssd(a[2 * u + 1], xx, _mm256_unpackhi_epi16(r0, r1));
+            }
+        }
+        // unpacklo holds units 0-3 and 8-11 of the 16, unpackhi 4-7 and 12-15
+        for (int u = 0; u < 2; ++u)
+        {
+            __m256i s[2] = {
+                _mm256_permute2x128_si256(a[2 * u], a[2 * u + 1], 0x20),
+                _mm256_permute2x128_si256(a[2 * u], a[2 * u + 1], 0x31) };
+            for (int v = 0; v < 2; ++v)
+            {
+                int k = j + 16 * u + 8 * v;
+                if (k >= n_hidden)
+                    break;
+                __m128i h = v ? _mm256_extracti128_si256(s1[u], 1) : _mm256_castsi256_si128(s1[u]);
+                __m256i t = _mm256_add_epi32(s[v], _mm256_mullo_epi32(_mm256_cvtepi16_epi32(h), xs));
+                _mm256_storeu_ps(acc + k, _mm256_fmadd_ps(_mm256_cvtepi32_ps(t), _mm256_loadu_ps(&d1[k]), _mm256_loadu_ps(&b1[k])));
+            }
+        }
+    }
+}
+
+void nn_eval::add_input_q(float* acc, int i, float dx) const
+{
+    __m256 d = _mm256_set1_ps(dx * x_scale);
+    const int8* w = &Q1[size_t(i) * n_q];
+    for (int j = 0; j < n_hidden; j += 8)
+    {
+        __m256 wj = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(w + j))));
+        _mm256_storeu_ps(acc + j, _mm256_fmadd_ps(_mm256_mul_ps(d, wj), _mm256_loadu_ps(&d1[j]), _mm256_loadu_ps(acc + j)));
+    }
+}
+
+void nn_eval::output_q(const float* acc, float* out) const
+{
+    // The hidden units as int16, 16 at a time, dot the int8 rows of Q2
+    __m256 hs = _mm256_set1_ps(float(h_scale));
+    __m256i y[n_outputs];
+    for (int o = 0; o < n_outputs; ++o)
+        y[o] = _mm256_setzero_si256();
+    for (int j = 0; j < n_hidden; j += 16)
+    {
+        __m256i h0 = _mm256_cvtps_epi32(_mm256_mul_ps(sigmoid256(_mm256_loadu_ps(acc + j)), hs));
+        __m256i h1 = j + 8 < n_hidden
+            ? _mm256_cvtps_epi32(_mm256_mul_ps(sigmoid256(_mm256_loadu_ps(acc + j + 8)), hs))
+            : _mm256_setzero_si256();
+        // packs interleaves the 128 bit lanes: restore the order of the units
+        __m256i h = _mm256_permute4x64_epi64(_mm256_packs_epi32(h0, h1), _MM_SHUFFLE(3, 1, 2, 0));
+        for (int o = 0; o < n_outputs; ++o)
+            y[o] = dpwssd(y[o], h, _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&Q2[size_t(o) * n_q + j]))));
+    }
+    for (int o = 0; o < n_outputs; ++o)
+        out[o] = 1.0f / (1.0f + std::exp(-(sum256(y[o]) * d2[o] + b2[o])));
+}
+
+float nn_eval::Pwin(const Board& b, Color to_move) const
+{
+    return outcome(b, to_move).win;
+}
+
+Outcome nn_eval::outcome(const Board& b, Color to_move) const
+{
+    alignas(32) float x[n_inputs];
+    float y[n_outputs];
+    encode(b, to_move, x);
+    forward(x, 1, y);
+    return Outcome{ y[0], y[1], y[2], y[3], y[4] };
+}
+
+void nn_gradient::clear(int n_hidden)
+{
+    W1.assign(size_t(nn_eval::n_inputs) * n_hidden, 0.0f);
+    b1.assign(n_hidden, 0.0f);
+    W2.assign(size_t(nn_eval::n_outputs) * n_hidden, 0.0f);
+    b2.assign(nn_eval::n_outputs, 0.0f);
+}
+
+void nn_eval::gradient(const float* x, const float* target, nn_gradient& g, float* out) const
+{
+    Assert(precision == Float);
+    alignas(32) float h[max_hidden], dh[max_hidden];
+    float y[n_outputs], dy[n_outputs];
+
+    accumulate(x, h);
+    for (int j = 0; j < n_hidden; ++j)
+        h[j] = 1.0f / (1.0f + std::exp(-h[j]));
+    for (int o = 0; o < n_outputs; ++o)
+    {
+        const float* w = &W2[size_t(o) * n_hidden];
+        float a = b2[o];
+        for (int j = 0; j < n_hidden; ++j)
+            a += w[j] * h[j];
+        y[o] = 1.0f / (1.0f + std::exp(-a));
+        dy[o] = (y[o] - target[o]) * y[o] * (1 - y[o]);
+    }
+    if (out)
+        std::copy(y, y + n_outputs, out);
+
+    // Output layer, then back to the hidden units
+    std::fill(dh, dh + n_hidden, 0.0f);
+    for (int o = 0; o < n_outputs; ++o)
+    {
+        const float* w = &W2[size_t(o) * n_hidden];
+        float* gw = &g.W2[size_t(o) * n_hidden];
+        for (int j = 0; j < n_hidden; ++j)
+        {
+            gw[j] += dy[o] * h[j];
+            dh[j] += dy[o] * w[j];
+        }
+        g.b2[o] += dy[o];
+    }
+    for (int j = 0; j < n_hidden; ++j)
+    {
+        dh[j] *= h[j] * (1 - h[j]);
+        g.b1[j] += dh[j];
+    }
+    // Only the rows of the non-zero inputs
+    for (int i = 0; i < n_inputs; ++i)
+        if (x[i] != 0.0f)
+        {
+            float* gw = &g.W1[size_t(i) * n_hidden];
+            for (int j = 0; j < n_hidden; ++j)
+                gw[j] += x[i] * dh[j];
+        }
+}
+
+void nn_eval::step(const nn_gradient& g, float alpha)
+{
+    Assert(precision == Float);
+    auto update = [alpha](std::vector<float>& w, const std::vector<float>& d) {
+        for (size_t k = 0; k < w.size(); ++k)
+            w[k] -= alpha * d[k];
+    };
+    update(W1, g.W1);
+    update(b1, g.b1);
+    update(W2, g.W2);
+    update(b2, g.b2);
+}
+
+nn_accumulator::nn_accumulator(const nn_eval& net, const Board& b, Color c)
+    : net(net), b(b), c(c), top(0), stack(size_t(max_depth + 1) * net.n_hidden)
+{
+    alignas(32) float x[nn_eval::n_inputs];
+    nn_eval::encode(b, opponent(c), x);
+    net.accumulate(x, &stack[0]);
+}
+
+void nn_accumulator::checker(float* acc, int unit, int n, int d) const
+{
+    // The units of n checkers are 1, 2, 3 or more, then (n-3)/2
+    int k = (d > 0) ? n : n - 1;
+    if (k < 3)
+        net.add_input(acc, unit + k, float(d));
+    else
+        net.add_input(acc, unit + 3, d * 0.5f);
+}
+
+void nn_accumulator::moved(Pip from, Pip to)
+{
+    Assert(top < max_depth);
+    const float* prev = &stack[size_t(top) * net.n_hidden];
+    float* acc = &stack[size_t(++top) * net.n_hidden];
+    std::copy(prev, prev + net.n_hidden, acc);
+
+    // The side c is the opponent of the side to move in the successors
+    if (from == 0)
+        net.add_input(acc, 193, -0.5f);
+    else
+        checker(acc, opp_unit(from), count(from), -1);
+
+    if (to == 25)
+    {
+        net.add_input(acc, 195, 1.0f / 15);
+        return;
+    }
+    int n = count(to);
+    if (n < 0)
+    {
+        // hit: the blot goes to the bar of the side to move
+        Assert(n == -1);
+        net.add_input(acc, own_unit(25 - to), -1.0f);
+        net.add_input(acc, 192, 0.5f);
+        n = 0;
+    }
+    checker(acc, opp_unit(to), n, +1);
+}
+
+void nn_accumulator::outcome(float* out) const
+{
+    net.output(&stack[size_t(top) * net.n_hidden], out);
+}
+
+float nn_accumulator::Pwin() const
+{
+    float y[nn_eval::n_outputs];
+    outcome(y);
+    return y[0];
+}
+
+nn_calibration calibrate(const nn_eval& f, const nn_eval& q, const std::vector<std::pair<Board, Color>>& boards)
+{
+    using clock = std::chrono::steady_clock;
+    nn_calibration r;
+    r.n = boards.size();
+    if (r.n == 0)
+        return r;
+
+    std::vector<float> X(r.n * nn_eval::n_inputs), Yf(r.n * nn_eval::n_outputs), Yq(r.n * nn_eval::n_outputs);
+    for (size_t k = 0; k < r.n; ++k)
+        nn_eval::encode(boards[k].first, boards[k].second, &X[k * nn_eval::n_inputs]);
+
+    auto t0 = clock::now();
+    f.forward(X.data(), r.n, Yf.data());
+    auto t1 = clock::now();
+    q.forward(X.data(), r.n, Yq.data());
+    auto t2 = clock::now();
+    r.ns_float = std::chrono::duration<double, std::nano>(t1 - t0).count() / r.n;
+    r.ns_int8 = std::chrono::duration<double, std::nano>(t2 - t1).count() / r.n;
+
+    double sum = 0.0;
+    for (size_t k = 0; k < r.n; ++k)
+    {
+        double d = std::abs(Yf[k * nn_eval::n_outputs] - Yq[k * nn_eval::n_outputs]);
+        sum += d;
+        r.max_pwin = std::max(r.max_pwin, d);
+        for (int o = 0; o < nn_eval::n_outputs; ++o)
+            r.max_output = std::max(r.max_output, double(std::abs(Yf[k * nn_eval::n_outputs + o] - Yq[k * nn_eval::n_outputs + o])));
+    }
+    r.mean_pwin = sum / r.n;
+    return r;
+}
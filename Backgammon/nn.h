@@ -0,0 +1,184 @@
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+#include "inttyp.h"
+#include "board.h"
+
+struct nn_gradient;
+
+// eval_context holds the shared instance
+/// <summary>
+/// Feed forward evaluator of contact positions (TD-Gammon style):
+/// n_inputs -> n_hidden sigmoid units -> n_outputs sigmoid units.
+///
+/// The inputs encode the board from the side to move: for each side, 4 units
+/// per pip (1, 2, 3 or more checkers, and (n-3)/2 beyond 3), then the bars / 2
+/// and the finished checkers / 15. The outputs are the Outcome of the side to move.
+///
+/// On disk:
+///		header
+///		float	W1[n_inputs][n_hidden]		input major: the row of an input is contiguous
+///		float	b1[n_hidden]
+///		float	W2[n_outputs][n_hidden]
+///		float	b2[n_outputs]
+///
+/// The net runs in float, or quantized (Int8) if asked for when it is loaded:
+/// int8 weights with a scale per hidden unit and per output, inputs as int16
+/// multiples of 1/30 (exact for this encoding), int16 hidden activations,
+/// int32 sums. The float weights are then released.
+/// </summary>
+struct nn_eval
+{
+	static const int n_inputs = 200;	// 196 used, padded to a multiple of 8
+	static const int n_outputs = 5;		// win, win gammon, win backgammon, lose gammon, lose backgammon
+	static const int max_hidden = 512;
+
+	struct header
+	{
+		char	magic[8];		// "BGNNET01"
+		uint32	version;
+		uint32	n_inputs;
+		uint32	n_hidden;
+		uint32	n_outputs;
+	};
+	static constexpr uint32 version = 1;
+	static constexpr const char* default_path = "contact.nn";
+
+	enum Precision { Float, Int8 };
+
+	int					n_hidden = 0;	// multiple of 8, at most max_hidden
+	Precision			precision = Float;
+	std::vector<float>	W1, b1, W2, b2;
+
+	// Quantized weights (Int8): x = xq / x_scale, h = hq / h_scale
+	static const int	x_scale = 30;
+	static const int	h_scale = 1 << 14;
+	int					n_q = 0;		// row length of Q1 and Q2: n_hidden padded to a multiple of 32
+	std::vector<int8>	Q1;				// n_inputs x n_q, input major as W1
+	std::vector<int8>	Q2;				// n_outputs x n_q
+	std::vector<float>	d1, d2;			// dequantization factors of the hidden units and of the outputs
+
+	/// <summary>
+	/// Small random weights of a net of n_hidden units (a start for training)
+	/// </summary>
+	void	init(int n_hidden, uint32 seed);
+	/// <summary>
+	/// Read the weights from the file 'path'
+	/// </summary>
+	/// <param name="p">Int8: quantize the weights once read</param>
+	/// <returns>false if missing or not a net of this encoding</returns>
+	bool	load(const std::string& path, Precision p = Float);
+	bool	save(const std::string& path) const;	// float nets only
+	/// <summary>
+	/// Switch a float net to int8 weights
+	/// </summary>
+	void	quantize();
+
+	/// <summary>
+	/// Input encoding of the board b, seen from the side to move
+	/// </summary>
+	static void	encode(const Board& b, Color to_move, float* x);
+
+	/// <summary>
+	/// Evaluate the n input vectors of X (n x n_inputs)
+	/// </summary>
+	/// <param name="out">n x n_outputs</param>
+	void	forward(const float* X, size_t n, float* out) const;
+	/// <summary>
+	/// Hidden layer pre-activations (the accumulator) of one input vector
+	/// </summary>
+	void	accumulate(const float* x, float* acc) const;
+	// Add dx * the weights of input i to the accumulator
+	void	add_input(float* acc, int i, float dx) const;
+	/// <summary>
+	/// Outputs from the accumulator: hidden sigmoids and the output layer
+	/// </summary>
+	void	output(const float* acc, float* out) const;
+
+	// The kernels of the Int8 precision
+	void	accumulate_q(const float* x, float* acc) const;
+	void	add_input_q(float* acc, int i, float dx) const;
+	void	output_q(const float* acc, float* out) const;
+
+	// P(win) of the side to move
+	float	Pwin(const Board& b, Color to_move) const;
+	Outcome	outcome(const Board& b, Color to_move) const;
+
+	/// <summary>
+	/// Add the gradient of 0.5 * |y - target|^2 to g, y the outputs of the input x (float nets)
+	/// </summary>
+	/// <param name="out">y</param>
+	void	gradient(const float* x, const float* target, nn_gradient& g, float* out = nullptr) const;
+	// Weights -= alpha * g
+	void	step(const nn_gradient& g, float alpha);
+};
+
+/// <summary>
+/// Gradient of the weights of an nn_eval, the same shapes
+/// </summary>
+struct nn_gradient
+{
+	std::vector<float>	W1, b1, W2, b2;
+
+	// Zero, for a net of n_hidden units
+	void	clear(int n_hidden);
+};
+
+/// <summary>
+/// NNUE style accumulator of the successors of a board: the hidden layer
+/// pre-activations of the board being generated, seen by the opponent of the
+/// side c which moves. A MoveContainer, or a member of one, following the
+/// generator's moved/unmoved protocol (see board.h): each checker moved pushes
+/// the accumulator plus the deltas of the few inputs it changes, unmoved pops.
+/// Only the output layer is left to evaluate each successor.
+/// </summary>
+struct nn_accumulator
+{
+	static const int max_depth = 4;		// checkers moved by one roll
+
+	/// <param name="b">the board the moves are generated on, in place</param>
+	/// <param name="c">the side moving</param>
+	nn_accumulator(const nn_eval& net, const Board& b, Color c);
+
+	// MoveContainer interface (moved is called before the board changes)
+	void	moved(Pip from, Pip to);
+	void	unmoved(Pip, Pip) { Assert(top > 0); --top; }
+
+	// Outputs of the current board, opponent(c) to move
+	void	outcome(float* out) const;
+	float	Pwin() const;
+
+private:
+	const nn_eval&		net;
+	const Board&		b;
+	Color				c;
+	int					top;
+	std::vector<float>	stack;	// (max_depth + 1) accumulators
+
+	// Checkers of c on its pip p (negative: the opponent's)
+	int		count(Pip p) const { return (c == White) ? b.pt<White>(p) : b.pt<Black>(p); }
+	// First input of a pip (relative to c) for c, and for the side to move (its pip p)
+	static int	opp_unit(Pip p) { return 96 + 4 * (p - 1); }
+	static int	own_unit(Pip p) { return 4 * (p - 1); }
+	// Add d (+1 or -1) to n checkers on the pip of input 'unit'
+	void	checker(float* acc, int unit, int n, int d) const;
+};
+
+/// <summary>
+/// Accuracy of a quantized net against the float net it was made from
+/// </summary>
+struct nn_calibration
+{
+	size_t	n = 0;				// boards
+	double	mean_pwin = 0.0;	// mean |P(win) difference|
+	double	max_pwin = 0.0;
+	double	max_output = 0.0;	// largest difference of any output
+	double	ns_float = 0.0;		// forward time per board
+	double	ns_int8 = 0.0;
+};
+
+/// <summary>
+/// Evaluate the boards, each seen from its side to move, with both nets
+/// </summary>
+nn_calibration	calibrate(const nn_eval& f, const nn_eval& q, const std::vector<std::pair<Board, Color>>& boards);
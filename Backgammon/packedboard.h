@@ -0,0 +1,251 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "board.h"
+
+/// <summary>
+/// A Board held in one 32 byte AVX2 register.
+///
+/// Bytes 0..25 are Board::board (White bar, pips 1..24, White finished),
+/// byte 26 is the Black bar and byte 27 the Black finished checkers.
+/// Every Black count is negative, so flipping the board is a single byte
+/// permutation followed by a negate. Pip counts are not stored; they are
+/// computed with a multiply-add when needed.
+/// </summary>
+struct PackedBoard
+{
+	__m256i v;
+
+	static constexpr int b_bar = 26;		// byte of the Black bar
+	static constexpr int b_finished = 27;	// byte of the Black finished checkers
+
+	PackedBoard() : v(_mm256_setzero_si256()) {}
+	explicit PackedBoard(__m256i v) : v(v) {}
+
+	// Board is the same 32 bytes, with Black bar/finished swapped and positive
+	explicit PackedBoard(const Board& b)
+	{
+		static_assert(sizeof(Board) == 32 && offsetof(Board, _finishedB) == 26 && offsetof(Board, _barB) == 27,
+			"PackedBoard requires the Board layout");
+		__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&b));
+		v = _mm256_sign_epi8(_mm256_shuffle_epi8(x, swap_bar_finished()), board_signs());
+	}
+
+	Board unpack() const
+	{
+		Board b;
+		__m256i x = _mm256_shuffle_epi8(_mm256_sign_epi8(v, board_signs()), swap_bar_finished());
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(&b), x);
+		b.pipCntW = pipW();
+		b.pipCntB = pipB();
+		return b;
+	}
+
+	int count(int i) const
+	{
+		alignas(32) int8 bytes[32];
+		_mm256_store_si256(reinterpret_cast<__m256i*>(bytes), v);
+		return bytes[i];
+	}
+	int Wbar()		const { return count(w_bar); }
+	int Bbar()		const { return -count(b_bar); }
+	int finishedW()	const { return count(25); }
+	int finishedB()	const { return -count(b_finished); }
+
+	bool operator== (const PackedBoard& b) const
+	{
+		return _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, b.v)) == -1;
+	}
+	bool operator!= (const PackedBoard& b) const { return !(*this == b); }
+
+	/// <summary>
+	/// The board from the perspective of the other side.
+	/// White pip p becomes Black pip 25-p, the bars and finished checkers
+	/// swap sides, and every count changes sign.
+	/// </summary>
+	PackedBoard flip() const
+	{
+		// pshufb only shuffles within 128 bit lanes: bytes coming from the
+		// other lane are taken from the lane swapped copy.
+		const __m256i same = _mm256_setr_epi8(
+			-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 15, 14, 13, 12, 11, 10,
+			-128, -128, -128, -128, -128, -128, -128, -128, -128, 11, -128, 9, -128, -128, -128, -128);
+		const __m256i cross = _mm256_setr_epi8(
+			10, 8, 7, 6, 5, 4, 3, 2, 1, 0, -128, -128, -128, -128, -128, -128,
+			9, 8, 7, 6, 5, 4, 3, 2, 1, -128, 0, -128, -128, -128, -128, -128);
+		__m256i swapped = _mm256_permute2x128_si256(v, v, 0x01);
+		__m256i x = _mm256_or_si256(_mm256_shuffle_epi8(v, same), _mm256_shuffle_epi8(swapped, cross));
+		return PackedBoard(_mm256_sub_epi8(_mm256_setzero_si256(), x));
+	}
+
+	// Pips (bytes) occupied by White: bit i is byte i
+	uint32 occW() const { return _mm256_movemask_epi8(_mm256_cmpgt_epi8(v, _mm256_setzero_si256())); }
+	// Pips (bytes) occupied by Black
+	uint32 occB() const { return _mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_setzero_si256(), v)); }
+	// Points held by 2 or more Black checkers
+	uint32 pointsB() const { return _mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_set1_epi8(-1), v)); }
+
+	// All W checkers in inner board or finished: none on the bar or pips 1..18
+	bool bareoffW() const { return (occW() & 0x7ffff) == 0; }
+	// All B checkers in inner board or finished: none on the bar or pips 7..24
+	bool bareoffB() const { return (occB() & (0x01ffff80 | 1 << b_bar)) == 0; }
+	bool bareoff_race() const { return bareoffW() && bareoffB(); }
+	// All W checkers on pips 15..24 or finished: bearoff_db covers White
+	bool bearoff10W() const { return (occW() & 0x7fff) == 0; }
+	// All B checkers on pips 1..10 or finished
+	bool bearoff10B() const { return (occB() & (0x01fff800 | 1 << b_bar)) == 0; }
+
+	/// <summary>
+	/// No contact: every White checker (bar 0) is past every Black checker (bar 25)
+	/// </summary>
+	bool race() const
+	{
+		uint32 w = occW() & (uint32(BOARD) | 1);
+		uint32 b = occB();
+		b = (b & uint32(BOARD)) | ((b >> b_bar) & 1) << 25;
+		return w == 0 || b == 0 || BSF(w) > BSR(b);
+	}
+
+	/// <summary>
+	/// PositionClass bits of the board, from a few compares and movemasks
+	/// </summary>
+	uint32 position_class() const
+	{
+		// Both sides with at least 8 checkers finished
+		uint32 fin = _mm256_movemask_epi8(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(7))) & 1 << 25;
+		fin &= _mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_set1_epi8(-7), v)) >> (b_finished - 25);
+		uint32 c = race() ? Race : Contact;
+		if (bearoff10W() && bearoff10B())
+		{
+			c |= Bearoff10;
+			if (bareoff_race())
+				c |= fin ? Bareoff | Exact : Bareoff;
+		}
+		return c;
+	}
+
+	int pipW() const
+	{
+		const __m256i weight = _mm256_setr_epi8(
+			25, 24, 23, 22, 21, 20, 19, 18, 17, 16, 15, 14, 13, 12, 11, 10,
+			9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 0, 0, 0, 0, 0, 0);
+		return sum(_mm256_maddubs_epi16(_mm256_max_epi8(v, _mm256_setzero_si256()), weight));
+	}
+	int pipB() const
+	{
+		const __m256i weight = _mm256_setr_epi8(
+			0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+			16, 17, 18, 19, 20, 21, 22, 23, 24, 0, 25, 0, 0, 0, 0, 0);
+		return sum(_mm256_maddubs_epi16(_mm256_max_epi8(_mm256_sub_epi8(_mm256_setzero_si256(), v), _mm256_setzero_si256()), weight));
+	}
+
+	/// <summary>
+	/// Move generation Info of White, as BoardInfo computes it for a flipped board
+	/// </summary>
+	void get_info(Info& info) const
+	{
+		// White checkers on the bar or pips 1..18
+		const __m256i outside = _mm256_setr_epi8(
+			1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+			1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+		info.occ_w = Bitboard(occW() & uint32(BOARD));
+		info.outside = sum(_mm256_maddubs_epi16(_mm256_max_epi8(v, _mm256_setzero_si256()), outside));
+		info.avail = andn((info.outside < 4 && Wbar() == 0) ? BAREOFF : BOARD, Bitboard(pointsB() & uint32(BOARD)));
+	}
+
+	/// <summary>
+	/// Move a checker of side C from pip 'from' to pip 'to' (C relative, 25 is off).
+	/// A blot on 'to' is hit without branching: the compare mask that finds it
+	/// is added to the destination, and the opponent's bar is updated from its movemask.
+	/// </summary>
+	/// <returns>true if a blot was hit</returns>
+	template<Color C = White>
+	bool move(Pip from, Pip to)
+	{
+		const __m256i zero = _mm256_setzero_si256();
+		__m256i f = unit(index<C>(from));
+		__m256i t = unit(index<C>(to));
+		// opponent blot on 'to': 0xff on that byte
+		__m256i blot = _mm256_and_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(C == White ? -1 : 1)), _mm256_cmpgt_epi8(t, zero));
+		int hit = _mm256_movemask_epi8(blot) != 0;
+		__m256i bar = _mm256_and_si256(unit(C == White ? b_bar : w_bar), _mm256_set1_epi8(-hit));
+		if (C == White)
+			v = _mm256_sub_epi8(_mm256_sub_epi8(_mm256_add_epi8(_mm256_sub_epi8(v, f), t), blot), bar);
+		else
+			v = _mm256_add_epi8(_mm256_add_epi8(_mm256_sub_epi8(_mm256_add_epi8(v, f), t), blot), bar);
+		return hit;
+	}
+	// Play die d from pip 'from', baring off when it reaches past 24
+	template<Color C = White>
+	bool play(Pip from, Die d) { return move<C>(from, std::min(from + d, 25)); }
+
+	struct SubMove
+	{
+		Pip	from;
+		Pip	to;
+	};
+
+	/// <summary>
+	/// Apply up to four sub-moves of side C in order
+	/// </summary>
+	/// <returns># of blots hit</returns>
+	template<Color C = White>
+	int apply(const SubMove* m, int n)
+	{
+		Assert(n <= 4);
+		int hits = 0;
+		for (int i = 0; i < n; ++i)
+			hits += move<C>(m[i].from, m[i].to);
+		return hits;
+	}
+
+private:
+	// Byte of the C relative pip p
+	template<Color C>
+	static int index(Pip p) { return (C == White) ? p : (p == w_bar) ? b_bar : (p == 25) ? b_finished : 25 - p; }
+
+	// 1 in byte i, 0 elsewhere
+	static __m256i unit(int i)
+	{
+		alignas(32) static const int8 window[64] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+			0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 };
+		Assert(0 <= i && i < 32);
+		return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(window + 32 - i));
+	}
+
+	// Sum of 16 int16
+	static int sum(__m256i x)
+	{
+		__m256i s = _mm256_madd_epi16(x, _mm256_set1_epi16(1));
+		__m128i t = _mm_add_epi32(_mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1));
+		t = _mm_add_epi32(t, _mm_shuffle_epi32(t, 0x4e));
+		t = _mm_add_epi32(t, _mm_shuffle_epi32(t, 0xb1));
+		return _mm_cvtsi128_si32(t);
+	}
+
+	// Exchange bytes 26 and 27 (Board keeps _finishedB before _barB), clear 28..31
+	static __m256i swap_bar_finished()
+	{
+		return _mm256_setr_epi8(
+			0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+			0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 11, 10, -128, -128, -128, -128);
+	}
+	// Negate the Black bar/finished bytes, clear 28..31
+	static __m256i board_signs()
+	{
+		return _mm256_setr_epi8(
+			1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+			1, 1, 1, 1, 1, 1, 1, 1, 1, 1, -1, -1, 0, 0, 0, 0);
+	}
+};
+
+/// <summary>
+/// MoveContainer collecting the successors as PackedBoards
+/// </summary>
+struct PackedBoards
+{
+	std::vector<PackedBoard> boards;
+
+	// MoveContainer interface
+	void push_board(const Board& b) { boards.emplace_back(b); }
+};
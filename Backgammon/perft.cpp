@@ -0,0 +1,465 @@
+// perft.cpp : Move generator benchmark and correctness suite.
+//
+// Enumerates every (roll, move) sequence to a given depth from a set of
+// reference positions, reporting node counts per depth and successors per
+// second. Optionally compares the successors of Board::genMoves with those
+// of a slow reference generator written directly from the rules.
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <set>
+#include <iterator>
+#include <string>
+#include <stdlib.h>
+#include "board.h"
+#include "packedboard.h"
+#include "pos_rank.h"
+#include "bearoff.h"
+
+using Clock = std::chrono::steady_clock;
+
+/// <summary>
+/// A named reference position, Black to move
+/// </summary>
+struct PerftPosition
+{
+    const char* name;
+    Board       board;
+};
+
+/// <summary>
+/// Build a position from White's perspective.
+/// White counts positive, Black counts negative.
+/// </summary>
+Board make_position(std::array<int8, 26> pips, int barB, int finishedB)
+{
+    Board b;
+    b.board = pips;
+    b._barB = barB;
+    b._finishedB = finishedB;
+    b.ComputePipCount();
+    return b;
+}
+
+Board make_bareoff(Board::inner_table w, Board::inner_table b)
+{
+    Board B(w, b);
+    B.ComputePipCount();
+    return B;
+}
+
+std::vector<PerftPosition> reference_positions()
+{
+    return {
+        { "start", Board() },
+        // Both sides on the bar, Black entering against a 3 point board with a White blot
+        { "bar", make_position({
+            1,
+            0, -2, 0, -2, -2, -4,
+            0,  0, 0,  0,  0, -2,
+            4,  0, 0,  0,  3,  0,
+            2,  2, 2,  0,  1,  0,
+            0 }, 3, 0) },
+        // Black checkers spread over many points, so doubles have many plays
+        { "doubles", make_position({
+            0,
+            2,  0, -1, -1, -1,  0,
+           -1, -1, -1, -1, -1,  0,
+           -2, -2, -2, -1,  0,  0,
+            3,  3,  3,  2,  2,  0,
+            0 }, 0, 0) },
+        // Both sides baring off
+        { "bareoff", make_bareoff({ 0, 2, 2, 3, 3, 2, 3 }, { 1, 3, 3, 2, 2, 2, 2 }) },
+    };
+}
+
+/// <summary>
+/// Slow reference move generator.
+/// Plays one checker at a time straight from the rules of the game:
+/// both dice must be played if possible, otherwise the higher die if possible.
+/// </summary>
+struct RefGen
+{
+    using Boards = std::set<Board>;
+
+    // Can White move a checker from pip 'from' with die 'd'
+    static bool legal(const Board& b, Pip from, Die d)
+    {
+        if (b.Wbar() && from != w_bar)
+            return false;
+        if (b.board[from] <= 0)
+            return false;
+        Pip to = from + d;
+        if (to <= 24)
+            return b.board[to] >= -1;
+
+        // baring off: every White checker must be in the inner board
+        for (int i = 0; i < 19; ++i)
+            if (b.board[i] > 0)
+                return false;
+        if (to == 25)
+            return true;
+        // excess roll: no White checker may be further from home
+        for (int i = 19; i < from; ++i)
+            if (b.board[i] > 0)
+                return false;
+        return true;
+    }
+
+    static void play(Board& b, Pip from, Die d)
+    {
+        Pip to = from + d;
+        if (to <= 24)
+            b.move(from, to);
+        else
+            b.bareOff(from, 25);
+    }
+
+    struct Play
+    {
+        Board   board;
+        int     used;   // # of dice played
+        Die     first;  // first die played
+    };
+
+    static uint64 packed_errors;    // PackedBoard moves which differ from Board moves
+
+    static void play(const Board& b, const Die* dice, int n, int i, Die first, std::vector<Play>& out)
+    {
+        bool moved = false;
+        if (i < n)
+        {
+            for (Pip from = 0; from <= 24; ++from)
+            {
+                if (!legal(b, from, dice[i]))
+                    continue;
+                Board next = b;
+                play(next, from, dice[i]);
+                PackedBoard packed(b);
+                packed.play(from, dice[i]);
+                packed_errors += (packed != PackedBoard(next));
+                play(next, dice, n, i + 1, i == 0 ? dice[i] : first, out);
+                moved = true;
+            }
+        }
+        if (!moved)
+            out.push_back(Play{ b, i, first });
+    }
+
+    static Boards genMoves(const Board& b, const Roll& r)
+    {
+        std::vector<Play> plays;
+        if (r.doubles())
+        {
+            Die dice[4] = { r.hi, r.hi, r.hi, r.hi };
+            play(b, dice, 4, 0, 0, plays);
+        }
+        else
+        {
+            Die hi_lo[2] = { r.hi, r.lo };
+            Die lo_hi[2] = { r.lo, r.hi };
+            play(b, hi_lo, 2, 0, 0, plays);
+            play(b, lo_hi, 2, 0, 0, plays);
+        }
+
+        int max_used = 0;
+        bool hi_played = false;
+        for (auto& p : plays)
+            max_used = std::max(max_used, p.used);
+        for (auto& p : plays)
+            hi_played |= (p.used == 1 && p.first == r.hi);
+
+        Boards boards;
+        for (auto& p : plays)
+        {
+            if (p.used != max_used)
+                continue;
+            if (max_used == 1 && !r.doubles() && hi_played && p.first != r.hi)
+                continue;
+            boards.insert(p.board);
+        }
+        return boards;
+    }
+};
+uint64 RefGen::packed_errors = 0;
+
+// Checkers born off by the side to move
+int finished(const Board& b, Color to_move)
+{
+    return to_move == White ? b.finished<White>() : b.finished<Black>();
+}
+
+/// <summary>
+/// Count (roll, move) sequences per depth.
+/// Moves are generated in place for the side to move, alternating colors,
+/// or (flip) by flipping the board so the side to move is always White.
+/// With 'first' the last ply stops generating at the first successor,
+/// counting (board, roll) pairs, to measure early termination.
+/// </summary>
+struct Perft
+{
+    std::vector<uint64> nodes;  // nodes[d] == # of sequences of length d
+    int depth;
+    bool flip;
+    bool first;
+    std::vector<Board>* boards = nullptr;   // collects the boards of the last ply if set
+
+    Perft(int depth, bool flip = false, bool first = false) : nodes(depth + 1), depth(depth), flip(flip), first(first) {}
+
+    void expand(const Board& b, int ply, Color to_move = Black);
+};
+
+/// <summary>
+/// Counts the successors of one (board, roll) and expands them to the next ply
+/// </summary>
+struct PerftNode
+{
+    Perft&  perft;
+    int     ply;
+    Color   to_move;
+
+    // MoveContainer interface
+    void push_board(const Board& b)
+    {
+        ++perft.nodes[ply];
+        if (ply == perft.depth && perft.boards)
+            perft.boards->push_back(b);
+        if (ply < perft.depth)
+        {
+            if (perft.flip)
+            {
+                if (b.finished() < 15)
+                    perft.expand(b, ply + 1);
+            }
+            else if (finished(b, to_move) < 15)
+                perft.expand(b, ply + 1, opponent(to_move));
+        }
+    }
+};
+
+void Perft::expand(const Board& b, int ply, Color to_move)
+{
+    if (flip)
+    {
+        BoardInfo B(b);
+        for (auto& r : Roll::rolls21)
+        {
+            PerftNode node{ *this, ply, to_move };
+            genMoves(node, B, r);
+        }
+        return;
+    }
+
+    // The board is restored after each roll, but children may reference it
+    Board B(b);
+    for (auto& r : Roll::rolls21)
+    {
+        if (first && ply == depth)
+        {
+            FirstMove f;
+            genMoves(f, B, r, to_move);
+            nodes[ply] += f.found;
+            continue;
+        }
+        PerftNode node{ *this, ply, to_move };
+        genMoves(node, B, r, to_move);
+    }
+}
+
+/// <summary>
+/// Collects the successors of one (board, roll)
+/// </summary>
+struct Collect
+{
+    std::vector<Board> boards;
+
+    // MoveContainer interface
+    void push_board(const Board& b) { boards.push_back(b); }
+};
+
+struct Verify
+{
+    uint64  positions = 0;  // (board, roll) pairs compared
+    uint64  generated = 0;  // successors pushed by genMoves
+    uint64  distinct = 0;   // distinct successors
+    uint64  errors = 0;     // (board, roll) pairs with a wrong successor set
+    uint64  packed = 0;     // successors whose PackedBoard flip, pips or classification differ
+    int     depth;
+
+    Verify(int depth) : depth(depth) {}
+
+    void report(const Board& b, const Roll& r, const RefGen::Boards& missing, const RefGen::Boards& extra)
+    {
+        if (++errors > 10)
+            return;
+        std::cout << std::endl << "MISMATCH roll " << r.hi << "-" << r.lo
+            << " missing: " << missing.size() << " extra: " << extra.size() << b;
+        for (auto& m : missing)
+            std::cout << "missing:" << m;
+        for (auto& x : extra)
+            std::cout << "extra:" << x;
+    }
+
+    // PackedBoard agrees with Board
+    static bool check_packed(const Board& b)
+    {
+        PackedBoard p(b);
+        Board f = b.flipped();
+        return p.flip() == PackedBoard(f) && p.flip().flip() == p
+            && p.pipW() == b.pipW() && p.pipB() == b.pipB()
+            && p.unpack() == b && p.unpack().pipW() == b.pipW()
+            && p.bareoffW() == b.bareoffW() && p.bareoffB() == b.bareoffB()
+            && p.bearoff10W() == bearoff_db::covers(b, White) && p.bearoff10B() == bearoff_db::covers(b, Black)
+            && bool(p.position_class() & Bareoff) == (b.bareoffW() && b.bareoffB())
+            && bool(p.position_class() & Exact) == (b.bareoffW() && b.bareoffB() && b.finishedW() >= 8 && b.finishedB() >= 8);
+    }
+
+    /// <summary>
+    /// Compare the in place successors of b for the side to move with RefGen.
+    /// RefGen moves White, so Black's successors are compared flipped.
+    /// </summary>
+    void verify(const Board& b, int ply, Color to_move = Black)
+    {
+        Board B(b);
+        Board W = (to_move == White) ? b : b.flipped();
+        for (auto& r : Roll::rolls21)
+        {
+            Collect c;
+            genMoves(c, B, r, to_move);
+            if (!(B == b))
+                std::cout << std::endl << "genMoves did not restore the board, roll " << r.hi << "-" << r.lo << B;
+
+            RefGen::Boards ref = RefGen::genMoves(W, r);
+            RefGen::Boards gen, missing, extra;
+            for (auto& s : c.boards)
+                gen.insert(to_move == White ? s : s.flipped());
+            std::set_difference(ref.begin(), ref.end(), gen.begin(), gen.end(), std::inserter(missing, missing.end()));
+            std::set_difference(gen.begin(), gen.end(), ref.begin(), ref.end(), std::inserter(extra, extra.end()));
+
+            for (auto& s : c.boards)
+                packed += !check_packed(s);
+
+            ++positions;
+            generated += c.boards.size();
+            distinct += gen.size();
+            if (!missing.empty() || !extra.empty())
+                report(W, r, missing, extra);
+
+            if (ply < depth)
+                for (auto& s : ref)
+                    if (s.finished() < 15)
+                        verify(to_move == White ? s : s.flipped(), ply + 1, opponent(to_move));
+        }
+    }
+};
+
+/// <summary>
+/// Rank and unrank the boards of the last ply, checking the keys are distinct and invert
+/// </summary>
+uint64 bench_rank(const Board& root, int depth)
+{
+    std::vector<Board> boards;
+    Perft perft(depth);
+    perft.boards = &boards;
+    perft.expand(root, 1);
+
+    std::vector<pos_rank::Key> keys;
+    keys.reserve(boards.size());
+    auto start = Clock::now();
+    for (auto& b : boards)
+        keys.push_back(prank.rank(b));
+    double rank_sec = std::chrono::duration<double>(Clock::now() - start).count();
+
+    uint64 errors = 0;
+    Board u;
+    start = Clock::now();
+    for (size_t i = 0; i < keys.size(); ++i)
+        errors += !(prank.unrank(keys[i], u) == boards[i]) || u.pipW() != boards[i].pipW() || u.pipB() != boards[i].pipB();
+    double unrank_sec = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::set<Board> distinct(boards.begin(), boards.end());
+    std::sort(keys.begin(), keys.end());
+    size_t distinct_keys = std::unique(keys.begin(), keys.end()) - keys.begin();
+    errors += distinct_keys != distinct.size();
+
+    std::cout << "rank depth " << depth << ": " << boards.size() << " boards, "
+        << distinct.size() << " distinct, " << distinct_keys << " distinct keys" << std::endl
+        << std::fixed << std::setprecision(0)
+        << "rank " << boards.size() / rank_sec << "/sec, unrank " << boards.size() / unrank_sec << "/sec, "
+        << errors << " errors" << std::endl;
+    return errors;
+}
+
+int usage(char** argv)
+{
+    std::cerr << "usage: " << std::endl
+        << argv[0] << " [-flip|-first|-rank] <depth> [<verify depth>] [<position>]" << std::endl
+        << "positions: start bar doubles bareoff (default all)" << std::endl
+        << "-flip: flip the board each ply instead of generating moves in place" << std::endl
+        << "-first: stop generating at the first successor on the last ply" << std::endl
+        << "-rank: benchmark pos_rank keys of the boards at <depth>" << std::endl;
+    return -1;
+}
+
+int main(int argc, char** argv)
+{
+    bool flip = argc > 1 && std::string(argv[1]) == "-flip";
+    bool first = argc > 1 && std::string(argv[1]) == "-first";
+    bool rank = argc > 1 && std::string(argv[1]) == "-rank";
+    if (flip || first || rank)
+        --argc, ++argv;
+    if (argc < 2)
+        return usage(argv);
+
+    int depth = atoi(argv[1]);
+    int verify_depth = argc > 2 ? atoi(argv[2]) : 0;
+    std::string only = argc > 3 ? argv[3] : "";
+    if (depth < 1)
+        return usage(argv);
+
+    uint64 errors = 0;
+    for (auto& pos : reference_positions())
+    {
+        if (!only.empty() && only != pos.name)
+            continue;
+
+        std::cout << std::endl << pos.name << pos.board << std::endl;
+        if (rank)
+        {
+            errors += bench_rank(pos.board, depth);
+            continue;
+        }
+        std::cout << "depth" << std::setw(16) << "nodes" << std::setw(12) << "sec" << std::setw(16) << "nodes/sec" << std::endl;
+
+        // Each depth is timed separately: perft(d) includes the generation of all shallower plies.
+        for (int d = 1; d <= depth; ++d)
+        {
+            Perft perft(d, flip, first);
+            auto start = Clock::now();
+            perft.expand(pos.board, 1);
+            double sec = std::chrono::duration<double>(Clock::now() - start).count();
+
+            uint64 total = 0;
+            for (auto n : perft.nodes)
+                total += n;
+            std::cout << std::setw(5) << d << std::setw(16) << perft.nodes[d]
+                << std::setw(12) << std::fixed << std::setprecision(3) << sec
+                << std::setw(16) << std::setprecision(0) << (sec > 0 ? total / sec : 0.0) << std::endl;
+        }
+
+        if (verify_depth > 0)
+        {
+            Verify v(verify_depth);
+            v.verify(pos.board, 1);
+            std::cout << "verify depth " << verify_depth << ": " << v.positions << " (board, roll) pairs, "
+                << v.generated << " generated, " << v.distinct << " distinct, "
+                << v.errors << " mismatches, "
+                << v.packed + RefGen::packed_errors << " PackedBoard mismatches" << std::endl;
+            errors += v.errors + v.packed + RefGen::packed_errors;
+            RefGen::packed_errors = 0;
+        }
+    }
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,108 @@
+#include "pos_rank.h"
+#include "board.h"
+
+pos_rank prank;  // singleton
+
+pos_rank::pos_rank()
+{
+    const int q_end = n_points + 1;   // the bars and finished checkers
+
+    for (int w = 0; w <= k; ++w)
+        for (int b = 0; b <= k; ++b)
+            n[q_end][w][b] = uint64(splits(w)) * splits(b);
+
+    for (int q = q_end; q >= 1; --q)
+    {
+        // cumulative sums of level q
+        for (int b = 0; b <= k; ++b)
+        {
+            cw[q][0][b] = 0;
+            for (int w = 0; w <= k; ++w)
+                cw[q][w + 1][b] = cw[q][w][b] + n[q][w][b];
+        }
+        for (int w = 0; w <= k; ++w)
+        {
+            cb[q][w][0] = 0;
+            for (int b = 0; b <= k; ++b)
+                cb[q][w][b + 1] = cb[q][w][b] + n[q][w][b];
+        }
+        if (q == 1)
+            break;
+
+        // point q-1: empty, 1..w White or 1..b Black checkers
+        for (int w = 0; w <= k; ++w)
+            for (int b = 0; b <= k; ++b)
+                n[q - 1][w][b] = n[q][w][b] + cw[q][w][b] + cb[q][w][b];
+    }
+    Assert(size() == 18330723507925781036ULL);
+}
+
+bool pos_rank::rankable(const Board& b)
+{
+    return b.Wbar() <= max_bar && b.Bbar() <= max_bar;
+}
+
+pos_rank::Key pos_rank::rank(const Board& b) const
+{
+    Assert(rankable(b));
+    int w = k, k_b = k;     // checkers left to place
+    Key r = 0;
+    for (int p = 1; p <= n_points; ++p)
+    {
+        int q = p + 1;
+        int c = b.board[p];
+        if (c > 0)
+        {
+            // skip empty and White 1..c-1
+            r += n[q][w][k_b] + cw[q][w][k_b] - cw[q][w - c + 1][k_b];
+            w -= c;
+        }
+        else if (c < 0)
+        {
+            // skip empty, every White count and Black 1..-c-1
+            r += n[q][w][k_b] + cw[q][w][k_b] + cb[q][w][k_b] - cb[q][w][k_b + c + 1];
+            k_b += c;
+        }
+    }
+    Assert(w == b.Wbar() + b.finishedW() && k_b == b.Bbar() + b.finishedB());
+    return r + Key(b.Wbar()) * splits(k_b) + b.Bbar();
+}
+
+Board& pos_rank::unrank(Key r, Board& b) const
+{
+    Assert(r < size());
+    int w = k, k_b = k;
+    for (int p = 1; p <= n_points; ++p)
+    {
+        int q = p + 1;
+        b.board[p] = 0;
+        if (r < n[q][w][k_b])
+            continue;
+        r -= n[q][w][k_b];
+        if (r < cw[q][w][k_b])
+        {
+            int c = 1;
+            for (; r >= n[q][w - c][k_b]; ++c)
+                r -= n[q][w - c][k_b];
+            b.board[p] = c;
+            w -= c;
+        }
+        else
+        {
+            r -= cw[q][w][k_b];
+            int c = 1;
+            for (; r >= n[q][w][k_b - c]; ++c)
+                r -= n[q][w][k_b - c];
+            b.board[p] = -c;
+            k_b -= c;
+        }
+    }
+    int s = splits(k_b);
+    int bar_w = int(r / s), bar_b = int(r % s);
+    b.board[0] = bar_w;
+    b.board[25] = w - bar_w;
+    b._barB = bar_b;
+    b._finishedB = k_b - bar_b;
+    b.ComputePipCount();
+    return b;
+}
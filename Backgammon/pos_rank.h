@@ -0,0 +1,58 @@
+#pragma once
+#include <array>
+#include "inttyp.h"
+
+struct Board;
+
+// singleton class
+/// <summary>
+/// Perfect ranking of full positions: a dense, collision free 64 bit key.
+///
+/// Positions are enumerated point by point (1..24 from White's side),
+/// each point being empty, held by White or held by Black, then the bar
+/// and finished checkers of both sides. The number of completions of a
+/// partial position depends only on the next point and the checkers of
+/// each side still to be placed, so ranks are sums of precomputed counts.
+///
+/// All 1.85e19 positions do not fit in 64 bits: keys cover positions with
+/// at most max_bar checkers of each side on the bar (1.83e19 positions).
+/// </summary>
+struct pos_rank
+{
+	using Key = uint64;
+
+	static const int n_points = 24;
+	static const int k = 15;		// checkers per side
+	static const int max_bar = 5;	// checkers on the bar of each side
+
+	// n[q][w][b] -- # of ways to place w White and b Black checkers on points q..24, the bars and off
+	std::array<std::array<std::array<uint64, k + 1>, k + 1>, n_points + 2>	n;
+	// cw[q][w][b] -- sum of n[q][y][b] for y < w
+	std::array<std::array<std::array<uint64, k + 1>, k + 2>, n_points + 2>	cw;
+	// cb[q][w][b] -- sum of n[q][w][y] for y < b
+	std::array<std::array<std::array<uint64, k + 2>, k + 1>, n_points + 2>	cb;
+
+	pos_rank();
+
+	// Number of positions with a key
+	Key size() const { return n[1][k][k]; }
+
+	// Bar/finished splits of c checkers not on the board
+	static int splits(int c) { return std::min(c, max_bar) + 1; }
+
+	// Positions outside the key range: too many checkers on a bar
+	static bool rankable(const Board& b);
+
+	/// <summary>
+	/// Key of the position b, 0 .. size()-1
+	/// </summary>
+	Key		rank	(const Board& b) const;
+
+	/// <summary>
+	/// Invert rank: writes the position with key r into b (with pip counts)
+	/// Returns b
+	/// </summary>
+	Board&	unrank	(Key r, Board& b) const;
+};
+
+extern struct pos_rank prank;	// singleton instance
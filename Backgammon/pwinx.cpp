@@ -5,11 +5,11 @@
 /// <summary>
 /// Accumulate the minimum of the P(win) values with hb to move
 /// of the boards pushed. (looked up in pwin vector) 
+/// The inner_hash base follows the moves of the generator from the hash of the root board.
 /// </summary>
-struct minPexact {
-    using Hash = eg_hash::Hash;
+struct minPexact : inner_hash {
     using Pwin_t = p_exact::Pwin_t;
-    minPexact(Hash hb, const Pwin_t& pwin) : pwin(pwin), hb(hb), min_p(std::numeric_limits<float>::infinity()) {}
+    minPexact(Hash hb, Hash root, const Pwin_t& pwin) : inner_hash(root), pwin(pwin), hb(hb), min_p(std::numeric_limits<float>::infinity()) {}
 
     const Pwin_t& pwin;
     Hash hb;
@@ -18,15 +18,17 @@ struct minPexact {
     // MoveContainer interface 
     void push_board(const Board& b)
     {
-        Hash hw = eg.hash_w(b);
-        min_p = std::min(min_p, pwin[hb][hw]);
+        Assert(hash == eg.hash_w(b));
+        min_p = std::min(min_p, pwin[hb][hash]);
     }
+    // The opponent can not do worse than P(win) == 0
+    bool stop() const { return min_p <= 0; }
 };
 
 float p_exact::init_p_exact(int hb, BoardInfo& b, const Roll& r)
 {
     // find minimum compute_enr over possible moves with roll 'r'
-    minPexact min_p(hb,p_win);
+    minPexact min_p(hb, eg.hash_w(b), p_win);
     genMoves(min_p, b, r);
     return min_p.min_p;
 }
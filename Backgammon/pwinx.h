@@ -48,8 +48,3 @@ struct p_exact
 	float Pwin(Hash toMove, Hash opp) { return p_win[toMove][opp]; }
 	float Pwin(eg_hash::BwHash h) { return Pwin(h.first, h.second); }
 };
-
-// Singleton instance of p_exact
-// Exact cubeless win rate of late endgame positions
-// Both sides baring off with at most 7 checkers
-extern p_exact exact;
\ No newline at end of file
@@ -2,18 +2,57 @@
 
 #include <array>
 #include <vector>
+#include <algorithm>
+#include <utility>
 
 using Die = int;
 
 struct Roll {
-	static const int order[6][6];	// lo.hi
-	static const std::vector<Roll> rolls21;
-
-	Roll(int d1, int d2) {
-		hi = std::max(d1, d2);
-		lo = std::min(d1, d2);
-		ordinal = order[lo - 1][hi - 1];
-		p = float(hi == lo ? 1.0 / 36 : 2.0 / 36);
+	// 6.6	24	20
+	// 5.5  20	19
+	// 4.4	16	18
+	// 3.3	12	17
+	// 6.5	11	16
+	// 6.4  10	15
+	// 5.4	 9	14
+	// 6.3	 9	13
+	// 2.2	 8	12
+	// 5.3	 8	11
+	// 6.2	 8	10
+	// 4.3	 7	 9
+	// 5.2	 7	 8
+	// 6.1	 7	 7
+	// 4.2	 6	 6
+	// 5.1	 6	 5
+	// 3.2	 5	 4
+	// 4.1	 5	 3
+	// 1.1	 4	 2
+	// 3.1	 4	 1
+	// 2.1	 3	 0
+	static constexpr int order[6][6] = { // lo.hi
+		{  2,  0,  1,  3,  5,  7},
+		{  0, 12,  4,  6,  8, 10},
+		{  0,  0, 17,  9, 11, 13},
+		{  0,  0,  0, 18, 14, 15},
+		{  0,  0,  0,  0, 19, 16},
+		{  0,  0,  0,  0,  0, 20}
+	};
+
+	constexpr Roll(int d1, int d2) :
+		hi(std::max(d1, d2)),
+		lo(std::min(d1, d2)),
+		ordinal(order[std::min(d1, d2) - 1][std::max(d1, d2) - 1]),
+		p(float(d1 == d2 ? 1.0 / 36 : 2.0 / 36))
+	{}
+
+	// The roll with the given ordinal
+	static constexpr Roll from_ordinal(int ordinal)
+	{
+		for (int lo = 1; lo <= 6; ++lo)
+			for (int hi = lo; hi <= 6; ++hi)
+				if (order[lo - 1][hi - 1] == ordinal)
+					return Roll(hi, lo);
+		return Roll(0, 0);	// not reached for 0..20
 	}
 
 	int	hi;			// 1..6
@@ -26,6 +65,18 @@ struct Roll {
 	bool operator==  (const Roll& r)	const { return ordinal == r.ordinal;	}
 	bool doubles()						const { return hi == lo;				}
 	bool pipCount()  					const { return hi == lo ? 4*hi : hi+lo; }
+
+	// The 21 distinct rolls in ordinal order: 2.1 < 3.1 < ... < 6.6
+	static const std::array<Roll, 21> rolls21;
 };
 
+template<size_t... I>
+constexpr std::array<Roll, sizeof...(I)> make_rolls(std::index_sequence<I...>)
+{
+	return { Roll::from_ordinal(I)... };
+}
+
+inline constexpr std::array<Roll, 21> Roll::rolls21 = make_rolls(std::make_index_sequence<21>());
+static_assert(Roll::rolls21[0].hi == 2 && Roll::rolls21[0].lo == 1 && Roll::rolls21[20].lo == 6, "rolls21 in ordinal order");
+
 extern const Roll& roll_dice();
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+#include "rollout.h"
+#include "eval.h"
+
+namespace {
+
+using PRNG = std::mt19937_64;
+
+// Sums of a variable over the games
+struct moments
+{
+    double  s = 0.0, s2 = 0.0;
+
+    void add(double x) { s += x; s2 += x * x; }
+    void add(const moments& m) { s += m.s; s2 += m.s2; }
+    rollout_estimate estimate(uint64 n) const
+    {
+        rollout_estimate e;
+        if (n == 0)
+            return e;
+        e.mean = s / n;
+        double var = n > 1 ? std::max(0.0, (s2 - s * e.mean) / (n - 1)) : 0.0;
+        e.std_error = std::sqrt(var / n);
+        return e;
+    }
+};
+
+struct game_sums
+{
+    moments pwin, pwin_raw, equity;
+};
+
+int finished(const Board& b, Color c)
+{
+    return (c == White) ? b.finishedW() : b.finishedB();
+}
+
+/// <summary>
+/// MoveContainer collecting the successors of the rolls of one turn
+/// </summary>
+struct successors
+{
+    std::vector<Board>  boards;
+    void push_board(const Board& b) { boards.push_back(b); }
+};
+
+/// <summary>
+/// The greedy 1-ply policy for the side c: the successor of least P(win) for
+/// the opponent, for each roll asked for. The successors of all the rolls are
+/// evaluated in one batch.
+/// </summary>
+class greedy
+{
+public:
+    // The best successor of each roll, and its P(win) for c
+    void    moves(Board& b, Color c, const Roll* rolls, int n)
+    {
+        s.boards.clear();
+        for (int k = 0; k < n; ++k)
+        {
+            first[k] = s.boards.size();
+            genMoves(s, b, rolls[k], c);
+        }
+        first[n] = s.boards.size();
+
+        p.resize(s.boards.size());
+        Board::eval(s.boards.data(), s.boards.size(), p.data(), opponent(c));
+        for (size_t i = 0; i < s.boards.size(); ++i)
+            if (finished(s.boards[i], c) == 15)
+                p[i] = 0.0f;
+
+        for (int k = 0; k < n; ++k)
+        {
+            if (first[k] == first[k + 1])
+            {
+                // No move: the opponent rolls on the same board
+                bool terminal;
+                best[k] = b;
+                value[k] = 1 - b.eval(terminal, opponent(c));
+                continue;
+            }
+            size_t m = first[k];
+            for (size_t i = first[k] + 1; i < first[k + 1]; ++i)
+                if (p[i] < p[m])
+                    m = i;
+            best[k] = s.boards[m];
+            value[k] = 1 - p[m];
+        }
+    }
+
+    Board   best[21];
+    float   value[21];
+
+private:
+    successors          s;
+    std::vector<float>  p;
+    size_t              first[22];
+};
+
+// Roll of index 0..35
+Roll roll36(uint64 i)
+{
+    return Roll(int(i % 6) + 1, int(i / 6 % 6) + 1);
+}
+
+// Play game k from b, to_move rolling; add its results for to_move to g
+void play(Board b, Color to_move, uint64 k, PRNG& rng, const rollout_options& opt, greedy& policy, game_sums& g)
+{
+    std::uniform_int_distribution<int> die(0, 35);
+    double luck = 0.0;
+    Color c = to_move;
+    for (int ply = 0; ; ++ply, c = opponent(c))
+    {
+        if (opt.truncate && (b.position_class() & Exact))
+        {
+            // No gammons in the p_exact region. c is on roll.
+            bool terminal;
+            double p = b.eval(terminal, c);
+            if (c != to_move)
+                p = 1 - p;
+            g.pwin_raw.add(p);
+            g.pwin.add(p - luck);
+            g.equity.add(2 * p - 1);
+            return;
+        }
+
+        Roll r = (opt.stratify && ply < 2) ? roll36(ply == 0 ? k : k / 36) : roll36(die(rng));
+        if (opt.luck_adjust)
+        {
+            // Luck of the roll: its value less the mean of the 21 rolls
+            policy.moves(b, c, Roll::rolls21.data(), 21);
+            double mean = 0.0;
+            for (auto& q : Roll::rolls21)
+                mean += q.p * policy.value[q.ordinal];
+            double l = policy.value[r.ordinal] - mean;
+            luck += (c == to_move) ? l : -l;
+            b = policy.best[r.ordinal];
+        }
+        else
+        {
+            policy.moves(b, c, &r, 1);
+            b = policy.best[0];
+        }
+
+        if (finished(b, c) == 15)
+        {
+            double win = (c == to_move) ? 1.0 : 0.0;
+            int points = b.points(c);
+            g.pwin_raw.add(win);
+            g.pwin.add(win - luck);
+            g.equity.add((c == to_move) ? points : -points);
+            return;
+        }
+    }
+}
+
+}
+
+rollout_result rollout(const Board& b, Color to_move, uint64 n, const rollout_options& opt)
+{
+    using clock = std::chrono::steady_clock;
+    auto t0 = clock::now();
+
+    int n_threads = opt.threads > 0 ? opt.threads : std::max(1, int(std::thread::hardware_concurrency()));
+    std::vector<game_sums> sums(n_threads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < n_threads; ++t)
+        threads.emplace_back([&, t] {
+            PRNG rng(opt.seed + 0x9E3779B97F4A7C15ull * t);
+            greedy policy;
+            for (uint64 k = t; k < n; k += n_threads)
+                play(b, to_move, k, rng, opt, policy, sums[t]);
+        });
+    for (auto& t : threads)
+        t.join();
+
+    game_sums g;
+    for (auto& s : sums)
+    {
+        g.pwin.add(s.pwin);
+        g.pwin_raw.add(s.pwin_raw);
+        g.equity.add(s.equity);
+    }
+    rollout_result r;
+    r.games = n;
+    r.pwin = g.pwin.estimate(n);
+    r.pwin_raw = g.pwin_raw.estimate(n);
+    r.equity = g.equity.estimate(n);
+    r.seconds = std::chrono::duration<double>(clock::now() - t0).count();
+    return r;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "board.h"
+#include "inttyp.h"
+
+struct rollout_options
+{
+	int		threads = 0;			// 0: one per hardware thread
+	uint64	seed = 1;
+	bool	stratify = true;		// first two rolls of game k: the rolls k % 36 and k / 36 % 36
+	bool	luck_adjust = true;		// subtract the luck of every roll from the P(win) of a game
+	bool	truncate = true;		// stop at p_exact races, worth their exact P(win)
+};
+
+// Mean of the games and its standard error
+struct rollout_estimate
+{
+	double	mean = 0.0;
+	double	std_error = 0.0;
+};
+
+struct rollout_result
+{
+	uint64				games = 0;
+	rollout_estimate	pwin;		// luck adjusted if asked for
+	rollout_estimate	pwin_raw;	// results of the games (exact P(win) when truncated)
+	rollout_estimate	equity;		// cubeless points, gammons included
+	double				seconds = 0.0;
+};
+
+/// <summary>
+/// Roll out the board b: n games played to completion by the greedy 1-ply
+/// policy on the static evaluator (Board::eval), in parallel threads. Thread t
+/// plays the games k = t mod threads with its own dice stream.
+///
+/// With luck_adjust, each turn evaluates the best move of all 21 rolls: the
+/// luck of a roll is its value less the mean of the 21, for the side rolling.
+/// The luck has a zero mean, so subtracting it from the result keeps the
+/// estimate unbiased, and removes most of the variance due to the dice.
+/// </summary>
+/// <returns>the estimates for the side to_move</returns>
+rollout_result	rollout(const Board& b, Color to_move, uint64 n, const rollout_options& opt = rollout_options());
@@ -62,7 +62,7 @@ struct Scm {
 	  0.99, 11.8737,
 #endif
 
-	const std::array<float, 50> _Y = {
+	static constexpr std::array<float, 50> _Y = {
 		  0.00000000,
 		  0.00137882,
 		  0.00551875,
@@ -118,21 +118,28 @@ struct Scm {
 	using it = decltype(_Y)::const_iterator;
 
 	// First and second divided difference of inverse relation
-	std::array<float, 50> D1;
-	std::array<float, 50> D2;
+	static const std::array<float, 50> D1;
+	static const std::array<float, 50> D2;
 
-	float Y(int i)	{ return _Y[i]; }
-	float Y(it i)	{ return *i; }
-	float X(int i)	{ return i + 50; }
+	static constexpr float Y(int i)	{ return _Y[i]; }
+	static constexpr float Y(it i)	{ return *i; }
+	static constexpr float X(int i)	{ return i + 50; }
 
-	// Initialize divided differences of the inverse relation: Y->X
-	void initDividedDifference()
+	// First divided differences of the inverse relation: Y->X
+	static constexpr std::array<float, 50> dividedDifference1()
 	{
-		D1[0] = D2[0] = D2[1] = 0.0;
+		std::array<float, 50> D1{};
 		for (int i = 1; i < 50; ++i)
 			D1[i] = 1.0 / (Y(i) - Y(i - 1));
+		return D1;
+	}
+	// Second divided differences of the inverse relation
+	static constexpr std::array<float, 50> dividedDifference2(const std::array<float, 50>& D1)
+	{
+		std::array<float, 50> D2{};
 		for (int i = 2; i < 50; ++i)
 			D2[i] = (D1[i] - D1[i - 1]) / (Y(i) - Y(i - 1));
+		return D2;
 	}
 
 	// Newton Quadratic Interpolation
@@ -150,8 +157,12 @@ struct Scm {
 	/// <returns></returns>
 	float NQI(float y)
 	{
-		Assert(f >= 0.0);
-		int n = std::lower_bound(_Y.begin(), _Y.end(), y) - _Y.begin();
+		Assert(y >= 0.0);
+		// Past the last ordinate (p = 0.99) the race is won
+		if (y >= _Y.back())
+			return 1.0;
+		// NQI(y, n) reads D2[n + 2]: the last 3 ordinates for the last interval
+		int n = std::min(int(std::lower_bound(_Y.begin(), _Y.end(), y) - _Y.begin()), 47);
 		return NQI(y, n)/100.0;
 	}
 
@@ -199,17 +210,24 @@ struct Scm {
 		return T.back().second/100.0;
 	}
 
-	// Single Checker Model
-	Scm() { initDividedDifference(); }
 };
 
-Scm scmDist;
+constexpr std::array<float, 50> Scm::D1 = Scm::dividedDifference1();
+constexpr std::array<float, 50> Scm::D2 = Scm::dividedDifference2(Scm::D1);
+
+Scm scmDist;	// Single Checker Model
 
-float ScmStat(int X, int Y)
+/// <summary>
+/// D^2/S statistic of a race
+/// </summary>
+/// <param name="X">pip count of the side to move</param>
+/// <param name="Y">pip count of the opponent</param>
+float ScmStat(float X, float Y)
 {
 	// 1/2mu ~ 4.0753
 	float D = Y - X + 4.0753;
-	float S = X + Y - 24.72588;
+	// S <= 0 in the last rolls of a race
+	float S = std::max(X + Y - 24.72588f, 1.0f);
 	// sign(D)*D^2/S
 	return std::abs(D) * D / S;
 }
@@ -228,6 +246,6 @@ float ScmPwin(float stat)
 /// <returns></returns>
 float ScmPwin(int W, int B)
 {
-	return ScmPwin(ScmStat(W, B));
+	return ScmPwin(ScmStat(B, W));
 }
 
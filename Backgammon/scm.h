@@ -3,9 +3,11 @@
 #include "enr.h"
 #include "pwinx.h"
 
-float ScmStat(int X, int Y);
+float ScmStat(float X, float Y);
 float ScmPwin(float stat); 
 
 float ScmPwin(int W, int B);
 
+// Average pips of a roll, doubles counted twice
+constexpr float pips_per_roll = 49.0f / 6;
 
@@ -0,0 +1,296 @@
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include "train.h"
+
+namespace {
+
+const int n_in = nn_eval::n_inputs;
+const int n_out = nn_eval::n_outputs;
+
+// Cubeless equity of outputs y
+inline float equity(const float* y)
+{
+    return 2 * y[0] - 1 + y[1] - y[3] + y[2] - y[4];
+}
+
+// The outputs y seen by the opponent: y is affine, so is the flip
+inline void flip(const float* y, float* f)
+{
+    float w = y[0], wg = y[1], wbg = y[2], lg = y[3], lbg = y[4];
+    f[0] = 1 - w;
+    f[1] = lg;
+    f[2] = lbg;
+    f[3] = wg;
+    f[4] = wbg;
+}
+
+/// <summary>
+/// MoveContainer keeping the successor of least equity for the opponent
+/// </summary>
+struct best_move
+{
+    best_move(const nn_eval& net, const Board& b, Color c) : acc(net, b, c), c(c) {}
+
+    nn_accumulator  acc;
+    Color           c;
+    Board           best;
+    float           min_e = std::numeric_limits<float>::infinity();
+
+    // MoveContainer interface
+    void moved(Pip from, Pip to) { acc.moved(from, to); }
+    void unmoved(Pip from, Pip to) { acc.unmoved(from, to); }
+    void push_board(const Board& b)
+    {
+        float e;
+        if ((c == White ? b.finishedW() : b.finishedB()) == 15)
+            e = -float(b.points(c));    // the game is over: its result, not the net
+        else
+        {
+            float y[n_out];
+            acc.outcome(y);
+            e = equity(y);
+        }
+        if (e < min_e)
+        {
+            min_e = e;
+            best = b;
+        }
+    }
+};
+
+}
+
+void td_trainer::play(const nn_eval& local, PRNG& rng, std::vector<float>& X, float* result, std::vector<dataset_record>& records) const
+{
+    std::uniform_int_distribution<int> die(1, 6);
+    size_t first = records.size();
+    Board b;
+    for (Color c = Black; ; c = opponent(c))
+    {
+        X.resize(X.size() + n_in);
+        nn_eval::encode(b, c, &X[X.size() - n_in]);
+
+        Roll r(die(rng), die(rng));
+        dataset_record rec;
+        if (!opt.log.empty() && make_record(b, c, rec))
+        {
+            rec.dice[0] = uint8(r.hi);
+            rec.dice[1] = uint8(r.lo);
+            records.push_back(rec);
+        }
+
+        best_move m(local, b, c);
+        genMoves(m, b, r, c);
+        if (m.min_e == std::numeric_limits<float>::infinity())
+            continue;   // no move: the same board, the opponent to move
+        b = m.best;
+
+        if ((c == White ? b.finishedW() : b.finishedB()) == 15)
+        {
+            int n = b.points(c);
+            result[0] = 1;
+            result[1] = n >= 2;
+            result[2] = n >= 3;
+            result[3] = result[4] = 0;
+            for (size_t k = first; k < records.size(); ++k)
+            {
+                bool won = records[k].side() == c;
+                records[k].source = dataset_record::game;
+                records[k].games = 1;
+                records[k].pwin = won ? 1.0f : 0.0f;
+                records[k].equity = float(won ? n : -n);
+            }
+            return;
+        }
+    }
+}
+
+void td_trainer::learn(const nn_eval& local, const std::vector<float>& X, const float* result, nn_gradient& g) const
+{
+    size_t T = X.size() / n_in;
+    std::vector<float> Y(T * n_out);
+    local.forward(X.data(), T, Y.data());
+
+    // lambda-returns, backward: G(t) = flip((1 - lambda) Y(t+1) + lambda G(t+1)),
+    // and the result of the game for the last position
+    float G[n_out], mix[n_out];
+    std::copy(result, result + n_out, G);
+    for (size_t t = T; t-- > 0; )
+    {
+        local.gradient(&X[t * n_in], G, g);
+        if (t == 0)
+            break;
+        for (int o = 0; o < n_out; ++o)
+            mix[o] = (1 - opt.lambda) * Y[t * n_out + o] + opt.lambda * G[o];
+        flip(mix, G);
+    }
+}
+
+void td_trainer::worker(uint64 seed, uint64 n)
+{
+    PRNG rng(seed);
+    nn_eval local;
+    nn_gradient g;
+    std::vector<float> X;
+    std::vector<dataset_record> records;
+    float result[n_out];
+
+    auto snapshot = [&] {
+        std::shared_lock<std::shared_mutex> lock(weights);
+        local = net;
+    };
+    auto update = [&] {
+        std::unique_lock<std::shared_mutex> lock(weights);
+        net.step(g, opt.alpha);
+    };
+
+    snapshot();
+    g.clear(local.n_hidden);
+    int pending = 0;
+    while (started++ < n)
+    {
+        X.clear();
+        play(local, rng, X, result, records);
+        learn(local, X, result, g);
+        if (!records.empty())
+        {
+            std::lock_guard<std::mutex> lock(log_lock);
+            for (auto& r : records)
+                log.append(r);
+            records.clear();
+        }
+        positions.fetch_add(X.size() / n_in);
+        ++games;
+
+        if (++pending == opt.batch)
+        {
+            update();
+            snapshot();
+            g.clear(local.n_hidden);
+            pending = 0;
+        }
+    }
+    if (pending)
+        update();
+}
+
+bool td_trainer::run(uint64 n, const std::function<void(const stats&)>& progress)
+{
+    Assert(net.precision == nn_eval::Float && net.n_hidden > 0);
+    using clock = std::chrono::steady_clock;
+    started = games = positions = 0;
+    if (!opt.log.empty() && !log.open(opt.log, true))
+        return false;
+
+    int n_threads = opt.threads > 0 ? opt.threads : std::max(1, int(std::thread::hardware_concurrency()));
+    std::vector<std::thread> threads;
+    auto t0 = clock::now();
+    for (int k = 0; k < n_threads; ++k)
+        threads.emplace_back(&td_trainer::worker, this, opt.seed + 0x9E3779B97F4A7C15ull * k, n);
+
+    bool saved = true;
+    auto checkpoint = [&] {
+        stats s{ games, positions, std::chrono::duration<double>(clock::now() - t0).count() };
+        {
+            std::shared_lock<std::shared_mutex> lock(weights);
+            saved &= net.save(opt.path);
+        }
+        if (progress)
+            progress(s);
+    };
+    for (uint64 next = opt.checkpoint; games < n; )
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (games >= next && games < n)
+        {
+            checkpoint();
+            next += opt.checkpoint;
+        }
+    }
+    for (auto& t : threads)
+        t.join();
+    checkpoint();
+    return log.close() && saved;
+}
+
+void td_trainer::fit_worker(const dataset_reader& data, int t, int n_threads)
+{
+    nn_eval local;
+    nn_gradient g;
+    float x[n_in], y[n_out], target[n_out];
+
+    auto snapshot = [&] {
+        std::shared_lock<std::shared_mutex> lock(weights);
+        local = net;
+    };
+    auto update = [&] {
+        std::unique_lock<std::shared_mutex> lock(weights);
+        net.step(g, opt.alpha);
+    };
+
+    snapshot();
+    g.clear(local.n_hidden);
+    int pending = 0;
+    for (uint64 i = t; i < data.size(); i += n_threads)
+    {
+        const dataset_record& r = data[i];
+        if (r.source == dataset_record::none)
+            continue;
+        nn_eval::encode(r.board(), r.side(), x);
+        if (r.source == dataset_record::game)
+        {
+            // The outcome of the game: the points are the equity
+            bool won = r.pwin > 0.5f;
+            int n = int(std::abs(r.equity) + 0.5f);
+            target[0] = won;
+            target[1] = won && n >= 2;
+            target[2] = won && n >= 3;
+            target[3] = !won && n >= 2;
+            target[4] = !won && n >= 3;
+        }
+        else
+        {
+            local.forward(x, 1, y);
+            std::copy(y, y + n_out, target);
+            target[0] = r.pwin;
+        }
+        local.gradient(x, target, g);
+        positions.fetch_add(1);
+
+        if (++pending == opt.fit_batch)
+        {
+            update();
+            snapshot();
+            g.clear(local.n_hidden);
+            pending = 0;
+        }
+    }
+    if (pending)
+        update();
+}
+
+bool td_trainer::fit(const dataset_reader& data, int epochs, const std::function<void(const stats&)>& progress)
+{
+    Assert(net.precision == nn_eval::Float && net.n_hidden > 0);
+    using clock = std::chrono::steady_clock;
+    positions = 0;
+
+    int n_threads = opt.threads > 0 ? opt.threads : std::max(1, int(std::thread::hardware_concurrency()));
+    auto t0 = clock::now();
+    bool saved = true;
+    for (int epoch = 1; epoch <= epochs; ++epoch)
+    {
+        std::vector<std::thread> threads;
+        for (int k = 0; k < n_threads; ++k)
+            threads.emplace_back(&td_trainer::fit_worker, this, std::cref(data), k, n_threads);
+        for (auto& t : threads)
+            t.join();
+        saved &= net.save(opt.path);
+        if (progress)
+            progress(stats{ uint64(epoch), positions, std::chrono::duration<double>(clock::now() - t0).count() });
+    }
+    return saved;
+}
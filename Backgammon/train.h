@@ -0,0 +1,85 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+#include "dataset.h"
+#include "nn.h"
+
+/// <summary>
+/// Self-play TD(lambda) training of a float nn_eval, in parallel threads.
+///
+/// Each thread plays games with a snapshot of the weights, every side taking
+/// the move of best cubeless equity (the successors evaluated by an
+/// nn_accumulator). At the end of a game the lambda-returns are computed
+/// backward from its result, and the gradients toward them accumulated.
+/// Every 'batch' games a thread applies its gradient to the shared weights
+/// under an exclusive lock, then takes a new snapshot.
+/// </summary>
+struct td_trainer
+{
+	struct options
+	{
+		int			threads = 0;		// 0: one per hardware thread
+		float		alpha = 0.02f;		// learning rate, per position
+		float		lambda = 0.7f;
+		int			batch = 4;			// games per gradient update of a thread
+		uint64		checkpoint = 10000;	// games between checkpoints
+		std::string	path = nn_eval::default_path;
+		uint64		seed = 1;
+		std::string	log;				// dataset to append the positions of the games to, none if empty
+		int			fit_batch = 256;	// positions per gradient update of a thread, in fit
+	};
+
+	struct stats
+	{
+		uint64	games;
+		uint64	positions;
+		double	seconds;
+
+		double	games_per_sec() const { return seconds > 0 ? games / seconds : 0.0; }
+	};
+
+	td_trainer(nn_eval& net, const options& opt) : net(net), opt(opt) {}
+
+	/// <summary>
+	/// Play n games. At each checkpoint, and at the end, the weights are saved
+	/// to opt.path and progress is called (from the calling thread).
+	/// The positions of the games are appended to the dataset opt.log, if any.
+	/// </summary>
+	/// <returns>false if the weights or the log could not be saved</returns>
+	bool	run(uint64 n, const std::function<void(const stats&)>& progress = nullptr);
+
+	/// <summary>
+	/// Supervised training on the results of a dataset, for 'epochs' passes
+	/// over its records: thread t takes the records t mod threads. The targets
+	/// are the P(win) of the records, and the gammons of the games played (the
+	/// other outputs of evaluations and rollouts are left as they are).
+	/// After each pass the weights are saved and progress is called, with the
+	/// passes as the games.
+	/// </summary>
+	/// <returns>false if the weights could not be saved</returns>
+	bool	fit(const dataset_reader& data, int epochs, const std::function<void(const stats&)>& progress = nullptr);
+
+private:
+	using PRNG = std::mt19937_64;
+
+	nn_eval&			net;
+	options				opt;
+	std::shared_mutex	weights;	// shared: snapshots and checkpoints, exclusive: updates
+	std::atomic<uint64>	started, games, positions;
+	dataset_writer		log;
+	std::mutex			log_lock;
+
+	void	worker(uint64 seed, uint64 n);
+	void	fit_worker(const dataset_reader& data, int t, int n_threads);
+	// Play a game with the weights of 'local': the inputs of its positions, each
+	// seen by its side to move, and the result seen by the side which moved last.
+	// The records of the positions, with their rolls and results, are added to 'records'.
+	void	play(const nn_eval& local, PRNG& rng, std::vector<float>& X, float* result, std::vector<dataset_record>& records) const;
+	// Add the gradients of the positions X toward their lambda-returns
+	void	learn(const nn_eval& local, const std::vector<float>& X, const float* result, nn_gradient& g) const;
+};